@@ -1,6 +1,8 @@
 #include "bytecode.h" // Chunk, chunk_*
 #include "compiler.h" // compile
 #include "mem.h"      // mem_stats
+#include "str.h"      // str_intern_destroy
+#include "tag.h"      // i64_pool_destroy
 #include "vm.h"       // interpret
 
 #include <assert.h>
@@ -38,6 +40,8 @@ void disassamble(const char *src) {
         chunk_disassamble_src(&c, src);
     }
     chunk_destroy(&c);
+    str_intern_destroy();
+    i64_pool_destroy();
 }
 
 bool run(const char *src) {
@@ -50,6 +54,8 @@ bool run(const char *src) {
         success = interpret(&c);
     }
     chunk_destroy(&c);
+    str_intern_destroy();
+    i64_pool_destroy();
     return success;
 }
 
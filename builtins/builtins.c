@@ -1,9 +1,15 @@
 #include "builtins.h"
 
+#include "file.h"
 #include "fun.h"
+#include "json.h"
 #include "list.h"
 #include "mem.h"
+#include "out.h"
+#include "range.h"
+#include "safemath.h"
 #include "str.h"
+#include "table.h"
 #include "tag.h"
 #include "vm.h" // run, call
 
@@ -11,14 +17,19 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 bool builtin_print(VM *vm, size_t arity) {
     size_t len = list_len(&vm->stack);
     for (size_t i = len - arity; i < len; i++) {
         Tag t = *list_get(&vm->stack, i);
-        tag_print(t);
+        out_tag(&vm->out, t);
+    }
+    out_char(&vm->out, '\n');
+    if (vm->out.err) {
+        runtime_err(vm, "cannot write output", 0);
+        return false;
     }
-    putchar('\n');
     *list_last(&vm->stack) = TAG_NIL;
     return true;
 }
@@ -28,9 +39,7 @@ static bool to_int(size_t len, Tag *t) {
         *t = i49_to_tag(len);
         return true;
     } else if (len < INT64_MAX) {
-        int64_t *i = mem_allocate(sizeof(*i));
-        *i = len;
-        *t = i64_to_tag(i);
+        *t = i64_new((int64_t)len);
         return true;
     }
     return false;
@@ -68,6 +77,13 @@ bool builtin_len(VM *vm, size_t arity) {
         }
         runtime_err_tag(vm, "string size too large: ", t);
         return false;
+    case TYPE_SHORT_STR:
+        *list_last(&vm->stack) = i49_to_tag(short_str_len(t));
+        return true;
+    case TYPE_RANGE:
+        // i49 bounds keep the length in the i49 range
+        *list_last(&vm->stack) = i49_to_tag(range_len(tag_to_range(t)));
+        return true;
     default: {
         runtime_err_tag(vm, "cannot len value: ", t);
         return false;
@@ -75,6 +91,216 @@ bool builtin_len(VM *vm, size_t arity) {
     }
 }
 
+bool builtin_join(VM *vm, size_t arity) {
+    if (arity != 2) {
+        runtime_err(vm, "join takes exactly two arguments", 0);
+        return false;
+    }
+    size_t len = list_len(&vm->stack);
+    Tag l = *list_get(&vm->stack, len - 2);
+    Tag sep = *list_get(&vm->stack, len - 1);
+    if (!tag_is_list(l)) {
+        runtime_err_tag(vm, "join expects a list as its first argument; got: ", l);
+        return false;
+    }
+    char sep_buf[SHORT_STR_MAX];
+    const char *sep_c;
+    size_t sep_len;
+    if (!as_str(sep, sep_buf, &sep_c, &sep_len)) {
+        runtime_err_tag(vm, "join expects a string separator; got: ", sep);
+        return false;
+    }
+    // size the result first to copy each string exactly once
+    List *list = tag_to_list(l);
+    size_t n = list_len(list);
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++) {
+        char buf[SHORT_STR_MAX];
+        const char *c;
+        size_t c_len;
+        Tag item = list_load(list, i);
+        if (!as_str(item, buf, &c, &c_len)) {
+            runtime_err_tag(vm, "join expects a list of strings; got: ", item);
+            tag_free(item);
+            return false;
+        }
+        if (size_t_add_over(total, c_len, &total) ||
+            (i > 0 && size_t_add_over(total, sep_len, &total))) {
+            runtime_err(vm, "joined string size too large", 0);
+            return false;
+        }
+    }
+    char short_buf[SHORT_STR_MAX];
+    String *result = total > SHORT_STR_MAX ? string_alloc(total) : 0;
+    char *dst = result ? result->c : short_buf;
+    for (size_t i = 0; i < n; i++) {
+        char buf[SHORT_STR_MAX];
+        const char *c;
+        size_t c_len;
+        as_str(list_load(list, i), buf, &c, &c_len);
+        if (i > 0) {
+            memcpy(dst, sep_c, sep_len);
+            dst += sep_len;
+        }
+        memcpy(dst, c, c_len);
+        dst += c_len;
+    }
+    *list_last(&vm->stack) = result ? string_to_tag(result) : short_str_to_tag(short_buf, total);
+    return true;
+}
+
+// Lists built here hold refs like the VM's own lists do: owned items move to temps, so storing
+// over an item can't free a value that's still referenced elsewhere.
+static void push_item(VM *vm, List *l, Tag t) {
+    if (tag_is_own(t)) {
+        list_append(&vm->temps, t);
+        t = tag_to_ref(t);
+    }
+    list_push(l, keep_line(vm, t), &vm->temps); // views of a whole line are the line itself
+}
+
+// String views. The results point into their argument's chars instead of copying them, see
+// str_view().
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+bool builtin_substr(VM *vm, size_t arity) {
+    if (arity < 2 || arity > 3) {
+        runtime_err(vm, "substr takes two or three arguments", 0);
+        return false;
+    }
+    size_t first = list_len(&vm->stack) - arity;
+    Tag s = *list_get(&vm->stack, first);
+    char buf[SHORT_STR_MAX];
+    const char *c;
+    size_t len;
+    if (!as_str(s, buf, &c, &len)) {
+        runtime_err_tag(vm, "substr expects a string; got: ", s);
+        return false;
+    }
+    int64_t bounds[2] = {0, (int64_t)len};
+    for (size_t i = 1; i < arity; i++) {
+        Tag t = *list_get(&vm->stack, first + i);
+        if (!as_int(t, &bounds[i - 1])) {
+            runtime_err_tag(vm, "substr bounds must be integers; got: ", t);
+            return false;
+        }
+    }
+    if (bounds[0] < 0 || bounds[0] > bounds[1] || (uint64_t)bounds[1] > len) {
+        runtime_err(vm, "substr bounds out of range", 0);
+        return false;
+    }
+    *list_last(&vm->stack) = str_view(s, c + bounds[0], (size_t)(bounds[1] - bounds[0]));
+    return true;
+}
+
+bool builtin_strip(VM *vm, size_t arity) {
+    if (arity != 1) {
+        runtime_err(vm, "strip takes exactly one argument", 0);
+        return false;
+    }
+    Tag s = *list_last(&vm->stack);
+    char buf[SHORT_STR_MAX];
+    const char *c;
+    size_t len;
+    if (!as_str(s, buf, &c, &len)) {
+        runtime_err_tag(vm, "strip expects a string; got: ", s);
+        return false;
+    }
+    const char *end = c + len;
+    for (; c < end && is_space(*c); c++) {
+    }
+    for (; end > c && is_space(end[-1]); end--) {
+    }
+    *list_last(&vm->stack) = str_view(s, c, end - c);
+    return true;
+}
+
+// find returns the index of the first occurrence of sub, or -1
+bool builtin_find(VM *vm, size_t arity) {
+    if (arity < 2 || arity > 3) {
+        runtime_err(vm, "find takes two or three arguments", 0);
+        return false;
+    }
+    size_t first = list_len(&vm->stack) - arity;
+    Tag s = *list_get(&vm->stack, first);
+    Tag sub = *list_get(&vm->stack, first + 1);
+    char buf[SHORT_STR_MAX], sub_buf[SHORT_STR_MAX];
+    const char *c, *sub_c;
+    size_t len, sub_len;
+    if (!as_str(s, buf, &c, &len) || !as_str(sub, sub_buf, &sub_c, &sub_len)) {
+        runtime_err(vm, "find expects two strings", 0);
+        return false;
+    }
+    int64_t start = 0;
+    if (arity == 3) {
+        Tag t = *list_last(&vm->stack);
+        if (!as_int(t, &start)) {
+            runtime_err_tag(vm, "find start must be an integer; got: ", t);
+            return false;
+        }
+        if (start < 0 || (uint64_t)start > len) {
+            runtime_err_tag(vm, "find start out of range: ", t);
+            return false;
+        }
+    }
+    const char *found = str_find(c + start, len - (size_t)start, sub_c, sub_len);
+    *list_last(&vm->stack) = found ? int_to_tag(found - c) : i49_to_tag(-1);
+    return true;
+}
+
+// split cuts the string at each sep, or at each run of whitespace without sep
+bool builtin_split(VM *vm, size_t arity) {
+    if (arity < 1 || arity > 2) {
+        runtime_err(vm, "split takes one or two arguments", 0);
+        return false;
+    }
+    size_t first = list_len(&vm->stack) - arity;
+    Tag s = *list_get(&vm->stack, first);
+    char buf[SHORT_STR_MAX], sep_buf[SHORT_STR_MAX];
+    const char *c, *sep_c = 0;
+    size_t len, sep_len = 0;
+    if (!as_str(s, buf, &c, &len)) {
+        runtime_err_tag(vm, "split expects a string; got: ", s);
+        return false;
+    }
+    if (arity == 2) {
+        Tag sep = *list_last(&vm->stack);
+        if (!as_str(sep, sep_buf, &sep_c, &sep_len)) {
+            runtime_err_tag(vm, "split expects a string separator; got: ", sep);
+            return false;
+        }
+        if (sep_len == 0) {
+            runtime_err(vm, "split separator cannot be empty", 0);
+            return false;
+        }
+    }
+    List *l = mem_allocate(sizeof(*l));
+    *l = (List){.kind = LIST_TAGS};
+    const char *end = c + len;
+    if (sep_c) {
+        for (const char *hit; (hit = str_find(c, end - c, sep_c, sep_len)); c = hit + sep_len) {
+            push_item(vm, l, str_view(s, c, hit - c));
+        }
+        push_item(vm, l, str_view(s, c, end - c));
+    } else {
+        while (c < end) {
+            for (; c < end && is_space(*c); c++) {
+            }
+            const char *word = c;
+            for (; c < end && !is_space(*c); c++) {
+            }
+            if (c > word) {
+                push_item(vm, l, str_view(s, word, c - word));
+            }
+        }
+    }
+    *list_last(&vm->stack) = list_to_tag(l);
+    return true;
+}
+
 bool builtin_noop(VM *vm, size_t arity) {
     (void)arity;                      // unused
     (void)vm;                         // unused
@@ -114,7 +340,7 @@ bool builtin_foreach(VM *vm, size_t arity) {
         List *l = tag_to_list(i);
         list_append(&vm->stack, f);
         for (size_t i = 0; i < list_len(l); i++) {
-            list_append(&vm->stack, *list_get(l, i));
+            list_append(&vm->stack, list_load(l, i));
             if (!call(vm, 1)) { // replaces the func with the result
                 return false;
             }
@@ -122,16 +348,131 @@ bool builtin_foreach(VM *vm, size_t arity) {
         }
         return true;
     }
+    case TYPE_RANGE: {
+        Range *r = tag_to_range(i);
+        list_append(&vm->stack, f);
+        for (size_t i = 0; i < range_len(r); i++) {
+            list_append(&vm->stack, i49_to_tag(range_get(r, i)));
+            if (!call(vm, 1)) {
+                return false;
+            }
+            *list_last(&vm->stack) = f;
+        }
+        return true;
+    }
     case TYPE_TABLE: {
-        runtime_err(vm, "table not implemented yet", 0);
-        return false;
+        Table *t = tag_to_table(i);
+        size_t len = table_len(t);
+        list_append(&vm->stack, f);
+        Tag key, val;
+        for (size_t pos = 0; table_next(t, &pos, &key, &val);) {
+            // the table keeps owning its keys and values
+            list_append(&vm->stack, tag_is_ptr(key) ? tag_to_ref(key) : key);
+            list_append(&vm->stack, tag_is_ptr(val) ? tag_to_ref(val) : val);
+            if (!call(vm, 2)) {
+                return false;
+            }
+            *list_last(&vm->stack) = f;
+            if (table_len(t) != len) {
+                runtime_err(vm, "table changed size during iteration", 0);
+                return false;
+            }
+        }
+        return true;
     }
     default:
-        runtime_err_tag(vm, "foreach expects a list or a table as its first argument; got: ", i);
+        runtime_err_tag(vm, "foreach expects a list, a range or a table as its first argument; got: ",
+                        i);
         return false;
     }
 }
 
+bool builtin_range(VM *vm, size_t arity) {
+    if (arity < 1 || arity > 3) {
+        runtime_err(vm, "range takes one to three arguments", 0);
+        return false;
+    }
+    Range r;
+    if (!range_args(vm, arity, &r)) {
+        return false;
+    }
+    *list_last(&vm->stack) = range_to_tag(range_new(r.start, r.stop, r.step));
+    return true;
+}
+
+bool builtin_read_file(VM *vm, size_t arity) {
+    if (arity != 1) {
+        runtime_err(vm, "read_file takes exactly one argument", 0);
+        return false;
+    }
+    Slice *file;
+    if (!file_arg(vm, *list_last(&vm->stack), &file)) {
+        return false;
+    }
+    *list_last(&vm->stack) = slice_to_tag(file);
+    return true;
+}
+
+// for-in loops over lines() walk the file lazily instead, see compile_for_in_statement()
+bool builtin_lines(VM *vm, size_t arity) {
+    if (arity != 1) {
+        runtime_err(vm, "lines takes exactly one argument", 0);
+        return false;
+    }
+    Slice *file;
+    if (!file_arg(vm, *list_last(&vm->stack), &file)) {
+        return false;
+    }
+    List *l = mem_allocate(sizeof(*l));
+    *l = (List){.kind = LIST_TAGS};
+    for (size_t pos = 0; pos < slice_len(file);) {
+        push_item(vm, l, file_line(file, &pos));
+    }
+    slice_free(file); // the lines hold their own references to the mapping
+    *list_last(&vm->stack) = list_to_tag(l);
+    return true;
+}
+
+bool builtin_json_parse(VM *vm, size_t arity) {
+    if (arity != 1) {
+        runtime_err(vm, "json_parse takes exactly one argument", 0);
+        return false;
+    }
+    Tag src = *list_last(&vm->stack);
+    char buf[SHORT_STR_MAX];
+    const char *c;
+    size_t len;
+    if (!as_str(src, buf, &c, &len)) {
+        runtime_err_tag(vm, "json_parse expects a string; got: ", src);
+        return false;
+    }
+    Tag result;
+    JsonError err;
+    if (!json_parse(src, &vm->temps, &result, &err)) {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "invalid json at offset %zu: %s", err.pos, err.msg);
+        runtime_err(vm, msg, 0);
+        return false;
+    }
+    *list_last(&vm->stack) = result;
+    return true;
+}
+
+bool builtin_json_dump(VM *vm, size_t arity) {
+    if (arity != 1) {
+        runtime_err(vm, "json_dump takes exactly one argument", 0);
+        return false;
+    }
+    Tag result;
+    JsonError err;
+    if (!json_dump(*list_last(&vm->stack), &result, &err)) {
+        runtime_err(vm, err.msg, err.detail);
+        return false;
+    }
+    *list_last(&vm->stack) = result;
+    return true;
+}
+
 bool builtin_stack_trace(VM *vm, size_t arity) {
     size_t skip = 1;
     if (arity == 1) {
@@ -159,6 +500,7 @@ bool builtin_stack_trace(VM *vm, size_t arity) {
         }
         skip = (uint64_t)wanted_skip;
     }
+    out_drain(&vm->out); // the trace goes after what print wrote so far
     for (size_t i = 0; i + skip < vm->current_frame; i++) {
         for (size_t j = 0; j < i; j++) {
             putchar(' ');
@@ -174,18 +516,339 @@ bool builtin_stack_trace(VM *vm, size_t arity) {
     return true;
 }
 
+// Numeric reductions. Packed lists go through kernels the compiler can vectorize, and any other
+// list is folded with tag_add, tag_mul and tag_less, like a bytecode loop would, so both paths
+// promote and overflow the same way. Doubles are summed in LANES interleaved partial sums, which
+// can differ from a left fold in the last bits.
+
+#define LANES 8
+
+// i49 ints can be added 2^14 at a time without overflowing an int64
+#define SUM_BLOCK ((size_t)1 << 14)
+
+static int64_t load_int(Tag t) { return (int64_t)t.u; }
+static double load_double(Tag t) { return t.d; }
+
+static bool sum_ints(const Tag *items, size_t len, int64_t *result) {
+    int64_t total = 0;
+    for (size_t start = 0; start < len; start += SUM_BLOCK) {
+        size_t end = len - start > SUM_BLOCK ? start + SUM_BLOCK : len;
+        uint64_t block = 0;
+        uint64_t out_of_range = 0;
+        for (size_t i = start; i < end; i++) {
+            block += items[i].u;
+            out_of_range |= items[i].u + I49_MAX > 2 * I49_MAX;
+        }
+        if (!out_of_range) {
+            if (i64_add_over(total, (int64_t)block, &total)) {
+                return false;
+            }
+            continue;
+        }
+        for (size_t i = start; i < end; i++) {
+            if (i64_add_over(total, load_int(items[i]), &total)) {
+                return false;
+            }
+        }
+    }
+    *result = total;
+    return true;
+}
+
+static double sum_doubles(const Tag *items, size_t len) {
+    double lanes[LANES] = {0};
+    size_t i = 0;
+    for (; i + LANES <= len; i += LANES) {
+        for (size_t j = 0; j < LANES; j++) {
+            lanes[j] += load_double(items[i + j]);
+        }
+    }
+    double total = 0;
+    for (size_t j = 0; j < LANES; j++) {
+        total += lanes[j];
+    }
+    for (; i < len; i++) {
+        total += load_double(items[i]);
+    }
+    return total;
+}
+
+static double dot_doubles(const Tag *a, const Tag *b, size_t len) {
+    double lanes[LANES] = {0};
+    size_t i = 0;
+    for (; i + LANES <= len; i += LANES) {
+        for (size_t j = 0; j < LANES; j++) {
+            lanes[j] += load_double(a[i + j]) * load_double(b[i + j]);
+        }
+    }
+    double total = 0;
+    for (size_t j = 0; j < LANES; j++) {
+        total += lanes[j];
+    }
+    for (; i < len; i++) {
+        total += load_double(a[i]) * load_double(b[i]);
+    }
+    return total;
+}
+
+// Products of i49 ints can overflow, so they are checked one by one.
+static bool dot_ints(const Tag *a, const Tag *b, size_t len, int64_t *result, const char **err) {
+    int64_t total = 0;
+    for (size_t i = 0; i < len; i++) {
+        int64_t product;
+        if (i64_mul_over(load_int(a[i]), load_int(b[i]), &product)) {
+            *err = "multiplication overflows";
+            return false;
+        }
+        if (i64_add_over(total, product, &total)) {
+            *err = "addition overflows";
+            return false;
+        }
+    }
+    *result = total;
+    return true;
+}
+
+// Every lane starts from the first item, so a NaN is only kept when it comes first, like in
+// a fold that replaces the result with each better item.
+#define BEST_KERNEL(name, T, load, better)                                                         \
+    static T name(const Tag *items, size_t len) {                                                  \
+        T lanes[LANES];                                                                            \
+        for (size_t j = 0; j < LANES; j++) {                                                       \
+            lanes[j] = load(items[0]);                                                             \
+        }                                                                                          \
+        size_t i = 0;                                                                              \
+        for (; i + LANES <= len; i += LANES) {                                                     \
+            for (size_t j = 0; j < LANES; j++) {                                                   \
+                T x = load(items[i + j]);                                                          \
+                lanes[j] = x better lanes[j] ? x : lanes[j];                                       \
+            }                                                                                      \
+        }                                                                                          \
+        T best = lanes[0];                                                                         \
+        for (size_t j = 1; j < LANES; j++) {                                                       \
+            best = lanes[j] better best ? lanes[j] : best;                                         \
+        }                                                                                          \
+        for (; i < len; i++) {                                                                     \
+            T x = load(items[i]);                                                                  \
+            best = x better best ? x : best;                                                       \
+        }                                                                                          \
+        return best;                                                                               \
+    }
+
+BEST_KERNEL(min_ints, int64_t, load_int, <)
+BEST_KERNEL(max_ints, int64_t, load_int, >)
+BEST_KERNEL(min_doubles, double, load_double, <)
+BEST_KERNEL(max_doubles, double, load_double, >)
+
+#undef BEST_KERNEL
+
+static Tag as_ref(Tag t) { return tag_is_own(t) ? tag_to_ref(t) : t; }
+
+#define LIST_ARG(vm, arity, name, l)                                                               \
+    list_arg(vm, arity, name " takes exactly one argument", name " expects a list; got: ", l)
+
+static bool list_arg(VM *vm, size_t arity, const char *arity_err, const char *type_err, List **l) {
+    if (arity != 1) {
+        runtime_err(vm, arity_err, 0);
+        return false;
+    }
+    Tag t = *list_last(&vm->stack);
+    if (!tag_is_list(t)) {
+        runtime_err_tag(vm, type_err, t);
+        return false;
+    }
+    *l = tag_to_list(t);
+    return true;
+}
+
+static bool sum(VM *vm, const List *l, Tag *result) {
+    size_t len = list_len(l);
+    if (l->kind == LIST_INTS) {
+        int64_t total;
+        if (!sum_ints(list_get(l, 0), len, &total)) {
+            runtime_err(vm, "addition overflows", 0);
+            return false;
+        }
+        *result = int_to_tag(total);
+        return true;
+    }
+    if (l->kind == LIST_DOUBLES) {
+        *result = double_to_tag(sum_doubles(list_get(l, 0), len));
+        return true;
+    }
+    Tag total = i49_to_tag(0);
+    for (size_t i = 0; i < len; i++) {
+        total = tag_add(total, list_load(l, i));
+        if (tag_is_error(total)) {
+            runtime_tag(vm, total);
+            tag_free(total);
+            return false;
+        }
+    }
+    *result = total;
+    return true;
+}
+
+bool builtin_sum(VM *vm, size_t arity) {
+    List *l;
+    Tag result;
+    if (!LIST_ARG(vm, arity, "sum", &l) || !sum(vm, l, &result)) {
+        return false;
+    }
+    *list_last(&vm->stack) = result;
+    return true;
+}
+
+bool builtin_mean(VM *vm, size_t arity) {
+    List *l;
+    if (!LIST_ARG(vm, arity, "mean", &l)) {
+        return false;
+    }
+    if (list_len(l) == 0) {
+        runtime_err(vm, "mean of an empty list", 0);
+        return false;
+    }
+    Tag total;
+    if (!sum(vm, l, &total)) {
+        return false;
+    }
+    Tag result = tag_div(total, double_to_tag((double)list_len(l)));
+    if (tag_is_error(result)) {
+        runtime_tag(vm, result);
+        tag_free(result);
+        return false;
+    }
+    *list_last(&vm->stack) = result;
+    return true;
+}
+
+static bool best(VM *vm, size_t arity, bool max) {
+    List *l;
+    if (max ? !LIST_ARG(vm, arity, "max", &l) : !LIST_ARG(vm, arity, "min", &l)) {
+        return false;
+    }
+    size_t len = list_len(l);
+    if (len == 0) {
+        runtime_err(vm, max ? "max of an empty list" : "min of an empty list", 0);
+        return false;
+    }
+    Tag *result = list_last(&vm->stack);
+    if (l->kind == LIST_INTS) {
+        *result = int_to_tag(max ? max_ints(list_get(l, 0), len) : min_ints(list_get(l, 0), len));
+        return true;
+    }
+    if (l->kind == LIST_DOUBLES) {
+        double d = max ? max_doubles(list_get(l, 0), len) : min_doubles(list_get(l, 0), len);
+        *result = double_to_tag(d);
+        return true;
+    }
+    Tag best = list_load(l, 0);
+    for (size_t i = 1; i < len; i++) {
+        Tag item = list_load(l, i);
+        Tag better = max ? tag_greater(as_ref(item), as_ref(best))
+                         : tag_less(as_ref(item), as_ref(best));
+        if (tag_is_error(better)) {
+            runtime_tag(vm, better);
+            tag_free(better);
+            tag_free(item);
+            tag_free(best);
+            return false;
+        }
+        if (tag_is_true(better)) {
+            tag_free(best);
+            best = item;
+        } else {
+            tag_free(item);
+        }
+    }
+    *result = best;
+    return true;
+}
+
+bool builtin_min(VM *vm, size_t arity) { return best(vm, arity, false); }
+
+bool builtin_max(VM *vm, size_t arity) { return best(vm, arity, true); }
+
+bool builtin_dot(VM *vm, size_t arity) {
+    if (arity != 2) {
+        runtime_err(vm, "dot takes exactly two arguments", 0);
+        return false;
+    }
+    size_t stack_len = list_len(&vm->stack);
+    Tag a_tag = *list_get(&vm->stack, stack_len - 2);
+    Tag b_tag = *list_get(&vm->stack, stack_len - 1);
+    if (!tag_is_list(a_tag) || !tag_is_list(b_tag)) {
+        runtime_err_tag(vm, "dot expects two lists; got: ", tag_is_list(a_tag) ? b_tag : a_tag);
+        return false;
+    }
+    List *a = tag_to_list(a_tag);
+    List *b = tag_to_list(b_tag);
+    size_t len = list_len(a);
+    if (len != list_len(b)) {
+        runtime_err(vm, "dot expects lists of the same length", 0);
+        return false;
+    }
+    Tag *result = list_last(&vm->stack);
+    if (a->kind == LIST_INTS && b->kind == LIST_INTS) {
+        int64_t total;
+        const char *err;
+        if (!dot_ints(list_get(a, 0), list_get(b, 0), len, &total, &err)) {
+            runtime_err(vm, err, 0);
+            return false;
+        }
+        *result = int_to_tag(total);
+        return true;
+    }
+    if (a->kind == LIST_DOUBLES && b->kind == LIST_DOUBLES) {
+        *result = double_to_tag(dot_doubles(list_get(a, 0), list_get(b, 0), len));
+        return true;
+    }
+    Tag total = i49_to_tag(0);
+    for (size_t i = 0; i < len; i++) {
+        Tag product = tag_mul(list_load(a, i), list_load(b, i));
+        if (!tag_is_error(product)) {
+            total = tag_add(total, product);
+        } else {
+            tag_free(total);
+            total = product;
+        }
+        if (tag_is_error(total)) {
+            runtime_tag(vm, total);
+            tag_free(total);
+            return false;
+        }
+    }
+    *result = total;
+    return true;
+}
+
 #define BUILTIN(n, f, s)                                                                           \
-    (Fun) {                                                                                        \
+    {                                                                                              \
         .type = FUN_BUILTIN, .builtin = {.name = SLICE(n), .fun = (f), .signature = SLICE(s) }     \
     }
 
 Fun builtins[] = {
     BUILTIN("print", builtin_print, "..."),
     BUILTIN("stack_trace", builtin_stack_trace, "skip=0"),
-    BUILTIN("len", builtin_len, "table/list/str"),
+    BUILTIN("len", builtin_len, "table/list/range/str"),
+    BUILTIN("join", builtin_join, "list, sep"),
+    BUILTIN("substr", builtin_substr, "str, start, end=len"),
+    BUILTIN("strip", builtin_strip, "str"),
+    BUILTIN("find", builtin_find, "str, sub, start=0"),
+    BUILTIN("split", builtin_split, "str, sep=whitespace"),
     BUILTIN("noop", builtin_noop, "..."),
     BUILTIN("call", builtin_call, "f"),
     BUILTIN("foreach", builtin_foreach, "iterable, fun"),
+    BUILTIN("range", builtin_range, "[start], stop, step=1"),
+    BUILTIN("read_file", builtin_read_file, "path"),
+    BUILTIN("lines", builtin_lines, "path"),
+    BUILTIN("json_parse", builtin_json_parse, "str"),
+    BUILTIN("json_dump", builtin_json_dump, "value"),
+    BUILTIN("sum", builtin_sum, "list"),
+    BUILTIN("mean", builtin_mean, "list"),
+    BUILTIN("min", builtin_min, "list"),
+    BUILTIN("max", builtin_max, "list"),
+    BUILTIN("dot", builtin_dot, "list, list"),
 };
 
 size_t builtins_n = sizeof(builtins) / sizeof(Fun);
@@ -8,4 +8,8 @@
 extern Fun builtins[];
 extern size_t builtins_n;
 
+// for-in loops check if they still call these, see OP_FOR_RANGE_INIT and OP_LINES_INIT
+bool builtin_range(VM *, size_t arity);
+bool builtin_lines(VM *, size_t arity);
+
 #endif
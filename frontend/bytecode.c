@@ -70,9 +70,22 @@ void chunk_patch_unary(Chunk *c, size_t bookmark, uint8_t op) {
     chunk_patch_unary_operand(c, bookmark, op, oper);
 }
 
+void chunk_rewind(Chunk *c, size_t label) {
+    assert(label <= chunk_label(c) && "invalid label");
+    dynarray_trunc(uint8_t)(&c->bytecode, label);
+    // lines hold running byte counts, the next byte is counted on the last line
+    for (size_t i = 0; i < dynarray_len(size_t)(&c->lines); i++) {
+        size_t *line = dynarray_get(size_t)(&c->lines, i);
+        if (*line > label) {
+            *line = label;
+        }
+    }
+}
+
 size_t chunk_record_const(Chunk *c, Tag t) {
     size_t idx = 0;
-    if (list_find_from(&c->consts, t, &idx)) {
+    // tables with int and float keys or values compare equal, so they aren't merged
+    if (!tag_is_table(t) && list_find_from(&c->consts, t, &idx)) {
         // prevent converting float literals to int literals
         if (tag_type(t) == tag_type(*list_get(&c->consts, idx))) {
             tag_free(t);
@@ -134,13 +147,19 @@ static size_t disassamble_op(const Chunk *chunk, size_t offset, size_t line) {
         break;
     }
     case OP_CALL:
+    case OP_DICT_N:
+    case OP_LIST_N:
     case OP_POP_N:
     case OP_SET_LOCAL:
     case OP_GET_LOCAL:
     case OP_LOOP:
     case OP_JUMP:
     case OP_JUMP_IF_FALSE:
-    case OP_JUMP_IF_TRUE: {
+    case OP_JUMP_IF_TRUE:
+    case OP_ITER_NEXT:
+    case OP_ITER_NEXT_KV:
+    case OP_FOR_RANGE_INIT:
+    case OP_FOR_RANGE: {
         uint64_t idx = chunk_read_operator(chunk, &offset);
         printf("%-16s %6" PRIu64 "\n", name, idx);
         break;
@@ -28,6 +28,7 @@ void chunk_patch_unary_operand(Chunk *, size_t bookmark, uint8_t op, uint64_t op
 void chunk_patch_unary(Chunk *, size_t bookmark, uint8_t op);
 
 inline size_t chunk_label(const Chunk *c) { return dynarray_len(uint8_t)(&c->bytecode); }
+void chunk_rewind(Chunk *, size_t label); // drops the code written after label
 inline void chunk_loop_to_label(Chunk *c, size_t line, size_t label) {
     size_t here = chunk_label(c);
     assert(here >= label);
@@ -7,6 +7,7 @@
 #include "list.h"     // List, list_*
 #include "mem.h"      // mem_allocate
 #include "str.h"      // Slice, slice
+#include "table.h"    // Table, table_*
 #include "tag.h"      // Tag, *_tag, tag_*
 
 #include <errno.h>
@@ -14,6 +15,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifndef NDEBUG
 static_assert(SIZE_MAX <= UINT64_MAX, "cannot safely cast size_t to uint64_t VM operands");
@@ -107,6 +109,7 @@ void trace_exit(void) {}
 static void compile_statement(Compiler *);
 static void compile_declaration(Compiler *);
 static void compile_var_declaration(Compiler *);
+static void get_var(Compiler *, Tag var);
 
 static void compiler_destroy(Compiler *c) {
     for (size_t i = 0; i < dynarray_len(Block)(&c->block_stack); i++) {
@@ -199,6 +202,14 @@ static bool match(Compiler *c, TokenType type) {
     return false;
 }
 
+// peek() returns the type of the token after the current one, without consuming anything
+static TokenType peek(const Compiler *c) {
+    Lexer lex = c->lex;
+    Token next;
+    lex_consume(&lex, &next);
+    return next.type;
+}
+
 Tag tag_slice_from_token(Token t) {
     // TODO: use a static slice in the caller instead of allways allocating
     // TODO: use a memory pool
@@ -267,10 +278,15 @@ static void compile_float(Compiler *c, bool _) {
 static void compile_string(Compiler *c, bool _) {
     (void)_; // unused
     trace_enter("compile_string", c);
-    // TODO: use a memory pool
-    Slice *s = mem_allocate(sizeof(*s));
-    *s = slice(c->prev.start + 1 /*skip 1st quote */, c->prev.end - 1 /* skip last quotes */);
-    size_t idx = chunk_record_const(c->chunk, slice_to_tag(s));
+    const char *start = c->prev.start + 1; // skip 1st quote
+    const char *end = c->prev.end - 1;     // skip last quote
+    Tag str;
+    if ((size_t)(end - start) <= SHORT_STR_MAX) {
+        str = short_str_to_tag(start, end - start);
+    } else {
+        str = tag_to_ref(string_to_tag(str_intern(start, end - start)));
+    }
+    size_t idx = chunk_record_const(c->chunk, str);
     chunk_write_unary(c->chunk, c->prev.line, OP_GET_CONSTANT, idx);
     trace_exit();
 }
@@ -507,6 +523,148 @@ static void compile_expression_statement(Compiler *c) {
     trace_exit();
 }
 
+// A for-in loop walks a list's items, or a table's keys, and the key/value form also gets the
+// list's indexes or the table's values. The iterated value and the iterator state are kept in
+// three hidden locals, whose names can't clash with identifiers:
+//
+//   for (k, v in t)            <t>
+//       <body>                 ITER_INIT
+//                          next:
+//                              ITER_NEXT_KV end    ; pushes k and v, or jumps to end
+//                              <body>
+//                              POP_N 2
+//                              LOOP next
+//                          end:
+//                              POP_N 3
+//
+// A single variable loop over range(start, end, step) is counted directly on the hidden locals,
+// its arguments are evaluated once and no range is ever built:
+//
+//   for (i in range(a, b))     GET_GLOBAL range
+//       <body>                 <a>
+//                              <b>
+//                              FOR_RANGE_INIT 2    ; checks the ints, fills in the default step
+//                          next:
+//                              FOR_RANGE end       ; pushes i and steps, or jumps to end
+//                              <body>
+//                              ...
+//
+// Likewise, a single variable loop over lines(path) maps the file and cuts each line when it's
+// needed, instead of building the list of lines first. A fourth hidden local holds the current
+// line, which is freed when the loop advances, and POP_N unmaps the file at the end:
+//
+//   for (l in lines(p))        GET_GLOBAL lines
+//       <body>                 <p>
+//                              LINES_INIT          ; maps the file, pushes its length and pos 0
+//                          next:
+//                              ITER_NEXT end
+//                              ...
+//                          end:
+//                              POP_N 4
+//
+// The globals can be set to other functions after the loop is compiled, so FOR_RANGE_INIT and
+// LINES_INIT check they still hold the builtins. If not, they call the function and set up the
+// hidden locals like ITER_INIT does.
+
+// is_builtin_call() tells if the current tokens start a call to builtin that isn't shadowed by a
+// local
+static bool is_builtin_call(Compiler *c, const char *builtin) {
+    Token t = c->current;
+    size_t len = strlen(builtin);
+    if (t.type != TOKEN_IDENTIFIER || (size_t)(t.end - t.start) != len ||
+        memcmp(t.start, builtin, len) != 0 || peek(c) != TOKEN_LEFT_PAREN) {
+        return false;
+    }
+    if (!in_block(c)) {
+        return true;
+    }
+    Tag name = tag_slice_from_token(t);
+    size_t idx;
+    bool local = resolve_local(c, name, &idx);
+    tag_free(name);
+    return !local;
+}
+
+static void compile_range_args(Compiler *c) {
+    advance(c);
+    get_var(c, tag_slice_from_token(c->prev)); // range
+    advance(c);                                // (
+    uint64_t args = 0;
+    do {
+        compile_expression(c);
+        args++;
+    } while (match(c, TOKEN_COMMA));
+    consume(c, TOKEN_RIGHT_PAREN, "missing paren after range arguments");
+    if (args > 3) {
+        err_at_prev(c, "range takes at most three arguments");
+    }
+    chunk_write_unary(c->chunk, c->prev.line, OP_FOR_RANGE_INIT, args);
+}
+
+static void compile_lines_arg(Compiler *c) {
+    advance(c);
+    get_var(c, tag_slice_from_token(c->prev)); // lines
+    advance(c);                                // (
+    compile_expression(c);
+    consume(c, TOKEN_RIGHT_PAREN, "missing paren after lines argument");
+    chunk_write_operation(c->chunk, c->prev.line, OP_LINES_INIT);
+}
+
+static void compile_for_in_statement(Compiler *c) {
+    trace_enter("compile_for_in_statement", c);
+    consume(c, TOKEN_IDENTIFIER, "missing variable name");
+    Tag key = TAG_NIL;
+    Tag var = tag_slice_from_token(c->prev);
+    bool kv = match(c, TOKEN_COMMA);
+    if (kv) {
+        consume(c, TOKEN_IDENTIFIER, "missing variable name after comma");
+        key = var;
+        var = tag_slice_from_token(c->prev);
+    }
+    consume(c, TOKEN_IN, "missing in after for variables");
+    bool range = !kv && is_builtin_call(c, "range");
+    bool lines = !kv && !range && is_builtin_call(c, "lines");
+    enter_block(c);
+    if (range) {
+        declare_local(c, short_str_to_tag("(cur)", 5), false);
+        declare_local(c, short_str_to_tag("(end)", 5), false);
+        declare_local(c, short_str_to_tag("(stp)", 5), false);
+        compile_range_args(c);
+    } else {
+        if (lines) {
+            declare_local(c, short_str_to_tag("(lin)", 5), false);
+        }
+        declare_local(c, short_str_to_tag("(seq)", 5), false);
+        if (lines) {
+            compile_lines_arg(c);
+        } else {
+            compile_expression(c);
+            chunk_write_operation(c->chunk, c->prev.line, OP_ITER_INIT);
+        }
+        declare_local(c, short_str_to_tag("(len)", 5), false);
+        declare_local(c, short_str_to_tag("(pos)", 5), false);
+    }
+    consume(c, TOKEN_RIGHT_PAREN, "missing paren after for");
+    initialize_local(c);
+    set_continue_label(c);
+    size_t next = chunk_label(c->chunk);
+    size_t jump_to_end = chunk_reserve_unary(c->chunk, c->prev.line);
+    enter_block(c);
+    if (kv && !declare_local(c, key, false)) {
+        tag_free(var);
+    } else {
+        declare_local(c, var, false);
+    }
+    initialize_local(c);
+    compile_statement(c); // the body
+    exit_block(c);
+    chunk_loop_to_label(c->chunk, c->prev.line, next);
+    OpCode op = range ? OP_FOR_RANGE : kv ? OP_ITER_NEXT_KV : OP_ITER_NEXT;
+    chunk_patch_unary(c->chunk, jump_to_end, op);
+    exit_block(c);
+    trace_exit();
+}
+
 // Because of the constraints inherent to a one-pass compiler, this loop:
 //
 //   for (var a = 10; a < 10; a++)
@@ -532,6 +690,11 @@ static void compile_expression_statement(Compiler *c) {
 static void compile_for_statement(Compiler *c) {
     trace_enter("compile_for_statement", c);
     consume(c, TOKEN_LEFT_PAREN, "missing paren after for");
+    if (c->current.type == TOKEN_IDENTIFIER && (peek(c) == TOKEN_IN || peek(c) == TOKEN_COMMA)) {
+        compile_for_in_statement(c);
+        trace_exit();
+        return;
+    }
     enter_block(c);
     if (match(c, TOKEN_SEMICOLON)) {
         // no initializer
@@ -665,7 +828,7 @@ static void compile_fun_statement(Compiler *c) { // TODO: make fun an expression
         assert(found && "cannot resolve local variable during declaration");
         chunk_write_unary(c->chunk, c->prev.line, OP_SET_LOCAL, idx);
     } else {
-        size_t idx = chunk_record_const(c->chunk, var);
+        size_t idx = chunk_record_const(c->chunk, tag_intern(var));
         chunk_write_unary(c->chunk, c->prev.line, OP_DEF_GLOBAL, idx);
     }
     size_t fun_start = chunk_reserve_unary(c->chunk, c->prev.line);
@@ -754,7 +917,7 @@ start:
         assert(found && "cannot resolve local variable during declaration");
         chunk_write_unary(c->chunk, c->prev.line, OP_SET_LOCAL, idx);
     } else {
-        size_t idx = chunk_record_const(c->chunk, var);
+        size_t idx = chunk_record_const(c->chunk, tag_intern(var));
         chunk_write_unary(c->chunk, c->prev.line, OP_DEF_GLOBAL, idx);
     }
     if (match(c, TOKEN_COMMA)) {
@@ -851,7 +1014,7 @@ static void get_var(Compiler *c, Tag var) {
         }
     }
     // in global scope or no local variable found in local and parent scopes
-    size_t idx = chunk_record_const(c->chunk, var);
+    size_t idx = chunk_record_const(c->chunk, tag_intern(var));
     chunk_write_unary(c->chunk, c->prev.line, OP_GET_GLOBAL, idx);
 }
 
@@ -865,7 +1028,7 @@ static void set_var(Compiler *c, Tag var) {
         }
     }
     // in global scope or no local variable found in local and parent scopes
-    size_t idx = chunk_record_const(c->chunk, var);
+    size_t idx = chunk_record_const(c->chunk, tag_intern(var));
     chunk_write_unary(c->chunk, c->prev.line, OP_SET_GLOBAL, idx);
 }
 
@@ -938,35 +1101,92 @@ static void compile_grouping(Compiler *c, bool _) {
     trace_exit();
 }
 
+// Checks if the code written since label only pushes a constant, and returns it.
+static bool written_constant(const Chunk *chunk, size_t label, Tag *t) {
+    size_t end = chunk_label(chunk);
+    if (label == end) {
+        return false;
+    }
+    switch (chunk_read_opcode(chunk, label)) {
+    case OP_GET_CONSTANT: {
+        size_t offset = label + 1;
+        *t = chunk_get_const(chunk, chunk_read_operator(chunk, &offset));
+        if (offset != end || tag_is_table(*t)) { // nested frozen tables would be shared
+            return false;
+        }
+        if (tag_is_ptr(*t)) {
+            *t = tag_to_ref(*t);
+        }
+        return true;
+    }
+    case OP_FALSE:
+        *t = TAG_FALSE;
+        return label + 1 == end;
+    case OP_NIL:
+        *t = TAG_NIL;
+        return label + 1 == end;
+    case OP_TRUE:
+        *t = TAG_TRUE;
+        return label + 1 == end;
+    default:
+        return false;
+    }
+}
+
 static void compile_dict(Compiler *c, bool _) {
     (void)_; // unused
     trace_enter("compile_dict", c);
-    chunk_write_operation(c->chunk, c->prev.line, OP_DICT);
+    size_t start = chunk_label(c->chunk);
+    // dicts of constants are built here, frozen, and loaded as a single constant
+    Table consts = {0};
+    bool all_consts = true;
+    size_t len = 0;
     while (!match(c, TOKEN_RIGHT_BRACE)) {
+        size_t label = chunk_label(c->chunk);
+        Tag key, val;
         compile_expression(c);
+        all_consts = all_consts && written_constant(c->chunk, label, &key);
         consume(c, TOKEN_COLON, "missing colon between key and value");
+        label = chunk_label(c->chunk);
         compile_expression(c);
-        chunk_write_operation(c->chunk, c->prev.line, OP_DICT_INIT);
+        all_consts = all_consts && written_constant(c->chunk, label, &val);
+        if (all_consts) {
+            table_set(&consts, tag_intern(key), val);
+        }
+        len++;
         if (!match(c, TOKEN_COMMA)) {
             consume(c, TOKEN_RIGHT_BRACE, "missing right brace after dictionary literal");
             break;
         }
     }
+    if (all_consts && !c->had_error && table_freeze(&consts)) {
+        chunk_rewind(c->chunk, start);
+        Table *t = mem_allocate(sizeof(*t));
+        *t = consts;
+        size_t idx = chunk_record_const(c->chunk, table_to_tag(t));
+        chunk_write_unary(c->chunk, c->prev.line, OP_GET_CONSTANT, idx);
+    } else {
+        table_destroy(&consts);
+        // all pairs are on the stack, build the dict in one go
+        chunk_write_unary(c->chunk, c->prev.line, OP_DICT_N, len);
+    }
     trace_exit();
 }
 
 static void compile_list(Compiler *c, bool _) {
     (void)_; // unused
     trace_enter("compile_list", c);
-    chunk_write_operation(c->chunk, c->prev.line, OP_LIST);
+    size_t len = 0;
     while (!match(c, TOKEN_RIGHT_BRACKET)) {
         compile_expression(c);
-        chunk_write_operation(c->chunk, c->prev.line, OP_LIST_INIT);
+        len++;
         if (!match(c, TOKEN_COMMA)) {
             consume(c, TOKEN_RIGHT_BRACKET, "missing right bracket after list literal");
             break;
         }
     }
+    // all items are on the stack, build the list in one go
+    chunk_write_unary(c->chunk, c->prev.line, OP_LIST_N, len);
     trace_exit();
 }
 
@@ -1078,6 +1298,7 @@ static CompileRule rules[] = {
     {0, 0, PREC_NONE},                           // TOKEN_FOR
     {0, 0, PREC_NONE},                           // TOKEN_FUN
     {0, 0, PREC_NONE},                           // TOKEN_IF
+    {0, 0, PREC_NONE},                           // TOKEN_IN
     {compile_literal, 0, PREC_NONE},             // TOKEN_NIL
     {0, compile_or, PREC_OR},                    // TOKEN_OR
     {0, 0, PREC_NONE},                           // TOKEN_RETURN
@@ -154,7 +154,15 @@ static TokenType identifier_type(const Lexer *lex) {
     case 'e':
         return check_keyword(lex, 1, 3, "lse", TOKEN_ELSE);
     case 'i':
-        return check_keyword(lex, 1, 1, "f", TOKEN_IF);
+        if (lex->current - lex->start > 1) {
+            switch (lex->start[1]) {
+            case 'f':
+                return check_keyword(lex, 1, 1, "f", TOKEN_IF);
+            case 'n':
+                return check_keyword(lex, 1, 1, "n", TOKEN_IN);
+            }
+        }
+        break;
     case 'n':
         return check_keyword(lex, 1, 2, "il", TOKEN_NIL);
     case 'o':
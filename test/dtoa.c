@@ -0,0 +1,109 @@
+#include "dtoa.h" // dtoa, DTOA_MAX
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RANDOM 2000000
+
+static uint64_t xorshift(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// the number of significant digits, without the leading and trailing zeros
+static size_t digits(const char *c) {
+    size_t n = 0, zeros = 0;
+    for (; *c && *c != 'e'; c++) {
+        if (*c == '0') {
+            zeros += n > 0;
+        } else if (*c >= '1' && *c <= '9') {
+            n += zeros + 1;
+            zeros = 0;
+        }
+    }
+    return n;
+}
+
+static void check(double d) {
+    char buf[DTOA_MAX + 1];
+    size_t len = dtoa(d, buf);
+    assert(len <= DTOA_MAX && "too long");
+    buf[len] = '\0';
+
+    double back = strtod(buf, 0);
+    assert(memcmp(&back, &d, sizeof(d)) == 0 && "doesn't round-trip");
+    (void)back; // unused without asserts
+    assert((strchr(buf, '.') || strchr(buf, 'e') || !isfinite(d)) && "looks like an int");
+
+    // no shorter precision round-trips
+    size_t n = digits(buf);
+    if (n > 1) {
+        char shorter[32];
+        snprintf(shorter, sizeof(shorter), "%.*e", (int)n - 2, d);
+        assert(strtod(shorter, 0) != d && "not the shortest");
+    }
+}
+
+static void check_str(double d, const char *expected) {
+    char buf[DTOA_MAX + 1];
+    size_t len = dtoa(d, buf);
+    buf[len] = '\0';
+    if (strcmp(buf, expected) != 0) {
+        fprintf(stderr, "got %s, expected %s\n", buf, expected);
+        assert(0 && "unexpected format");
+    }
+}
+
+int main(void) {
+    check_str(0.0, "0.0");
+    check_str(-0.0, "-0.0");
+    check_str(1.0, "1.0");
+    check_str(-3.0, "-3.0");
+    check_str(0.1, "0.1");
+    check_str(0.3, "0.3");
+    check_str(0.1 + 0.2, "0.30000000000000004");
+    check_str(2.5, "2.5");
+    check_str(123.456, "123.456");
+    check_str(1e15, "1000000000000000.0");
+    check_str(1e16, "1e+16");
+    check_str(1.5e17, "1.5e+17");
+    check_str(0.0001, "0.0001");
+    check_str(0.00001, "1e-05");
+    check_str(1.5e-7, "1.5e-07");
+    check_str(1e300, "1e+300");
+    check_str(DBL_MAX, "1.7976931348623157e+308");
+    check_str(DBL_MIN, "2.2250738585072014e-308");
+    check_str(5e-324, "5e-324");
+    check_str(9007199254740993.0, "9007199254740992.0");
+    check_str(INFINITY, "inf");
+    check_str(-INFINITY, "-inf");
+    check_str(NAN, "nan");
+
+    // powers of two have a closer lower neighbour
+    for (int e = -1074; e <= 1023; e++) {
+        check(ldexp(1, e));
+    }
+    for (int e = -30; e <= 30; e++) {
+        for (int i = 1; i < 1000; i++) {
+            check(i * pow(10, e));
+        }
+    }
+    uint64_t state = 1337;
+    for (size_t i = 0; i < RANDOM; i++) {
+        uint64_t bits = xorshift(&state);
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        if (!isnan(d)) {
+            check(d);
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,55 @@
+#include "dtoa.h" // dtoa, DTOA_MAX
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CYCLES 5000000
+
+static double short_double(uint64_t i) { return (double)(i % 100000) / 100; }
+static double long_double(uint64_t i) { return 1 / (double)(i + 3); }
+static double random_double(uint64_t i) {
+    // random bits, spread over all the exponents
+    uint64_t bits = (i * UINT64_C(0x9E3779B97F4A7C15)) & ~(UINT64_C(1) << 63);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return isfinite(d) ? d : 1.0;
+}
+
+static const struct {
+    const char *name;
+    double (*num)(uint64_t);
+} doubles[] = {
+    {"short", short_double},
+    {"long", long_double},
+    {"random", random_double},
+};
+
+// the format print used before dtoa, which doesn't always round-trip
+static size_t printf_double(double d, char *buf) {
+    return snprintf(buf, 512, floor(d) == d ? "%.1f" : "%.16g", d);
+}
+
+static void bench(const char *name, size_t (*format)(double, char *), double (*num)(uint64_t)) {
+    char buf[512];
+    uint64_t chars = 0;
+    clock_t start = clock();
+    for (uint64_t i = 0; i < CYCLES; i++) {
+        chars += format(num(i), buf);
+    }
+    clock_t duration = clock() - start;
+    fprintf(stderr, "  %-6s chars:%10" PRIu64 " duration:%8lu\n", name, chars, duration);
+}
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(doubles) / sizeof(doubles[0]); i++) {
+        fprintf(stderr, "%s\n", doubles[i].name);
+        bench("printf", printf_double, doubles[i].num);
+        bench("dtoa", dtoa, doubles[i].num);
+    }
+    return EXIT_SUCCESS;
+}
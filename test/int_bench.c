@@ -0,0 +1,70 @@
+#include "list.h" // List, list_*
+#include "mem.h"  // mem_stats
+#include "tag.h"  // Tag, *_tag, tag_*
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CYCLES 20000000
+#define KEPT 5000000
+
+static void print_calls(void) {
+#ifdef SLANG_DEBUG
+    fprintf(stderr, "allocator calls:%10" PRIu64 "\n", mem_stats.calls);
+    mem_stats.calls = 0;
+#endif
+}
+
+// Values just above I49_MAX are boxed, every op on a ref needs a new box and every intermediate
+// result is freed or reused by the next op.
+static void bench_temporaries(void) {
+    Tag base = i64_new(I49_MAX + 1);
+    Tag acc = i49_to_tag(0);
+    clock_t start = clock();
+    for (int64_t i = 0; i < CYCLES; i++) {
+        Tag x = tag_add(tag_to_ref(base), i49_to_tag(i & 0xffff)); // new box
+        Tag y = tag_add(tag_mul(x, i49_to_tag(3)), i49_to_tag(-i)); // reuses x's box
+        acc = tag_add(acc, tag_mod(y, i49_to_tag(7)));
+    }
+    clock_t duration = clock() - start;
+    int64_t result = 0;
+    as_int(acc, &result);
+    fprintf(stderr, "temporaries\n");
+    fprintf(stderr, "result:%12" PRId64 " duration:%8lu\n", result, duration);
+    print_calls();
+    tag_free(acc);
+    tag_free(base);
+}
+
+// Results that outlive the loop, like the VM's temps, keep their boxes until the end.
+static void bench_kept(void) {
+    List kept = {0};
+    clock_t start = clock();
+    for (int64_t i = 0; i < KEPT; i++) {
+        list_append(&kept, tag_add(i49_to_tag(I49_MAX), i49_to_tag(i + 1)));
+    }
+    for (size_t i = 0; i < list_len(&kept); i += 2) {
+        tag_free(*list_get(&kept, i));
+        *list_get(&kept, i) = tag_add(i49_to_tag(I49_MAX), i49_to_tag(2));
+    }
+    clock_t duration = clock() - start;
+    fprintf(stderr, "kept\n");
+    fprintf(stderr, "len:%12zu duration:%8lu\n", list_len(&kept), duration);
+    print_calls();
+    list_destroy(&kept);
+}
+
+int main(void) {
+    bench_temporaries();
+    bench_kept();
+    i64_pool_destroy();
+
+#ifdef SLANG_DEBUG
+    assert(mem_stats.bytes == 0 && "unfreed memory");
+#endif
+
+    return EXIT_SUCCESS;
+}
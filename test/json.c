@@ -0,0 +1,116 @@
+#include "json.h"  // json_parse, json_dump
+#include "list.h"  // List, list_*
+#include "mem.h"   // mem_stats
+#include "str.h"   // string_new, str_intern_destroy
+#include "table.h" // Table, table_*
+#include "tag.h"   // Tag, tag_*
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static List owned;
+
+static Tag str(const char *c) { return string_to_tag(string_new(c, strlen(c))); }
+
+static Tag parse(const char *json) {
+    Tag src = str(json);
+    list_append(&owned, src); // views borrow the source
+    Tag result;
+    JsonError err;
+    bool success = json_parse(src, &owned, &result, &err);
+    if (!success) {
+        fprintf(stderr, "%s at %zu in %s\n", err.msg, err.pos, json);
+        assert(0 && "parse failed");
+    }
+    return result;
+}
+
+static void check_dump(Tag t, const char *expected) {
+    Tag dump;
+    JsonError err;
+    bool success = json_dump(t, &dump, &err);
+    assert(success && "dump failed");
+    (void)success; // unused without asserts
+    Tag want = str(expected);
+    if (!tag_eq(dump, want)) {
+        fprintf(stderr, "got ");
+        tag_printf(stderr, dump);
+        fprintf(stderr, ", expected %s\n", expected);
+        assert(0 && "unexpected dump");
+    }
+    tag_free(want);
+    tag_free(dump);
+}
+
+// the JSON text parses and dumps back as expected
+static void check(const char *json, const char *expected) { check_dump(parse(json), expected); }
+
+static void check_error(const char *json, size_t pos) {
+    Tag src = str(json);
+    Tag result;
+    JsonError err;
+    bool success = json_parse(src, &owned, &result, &err);
+    assert(!success && "invalid json parsed");
+    (void)success; // unused without asserts
+    if (err.pos != pos) {
+        fprintf(stderr, "%s at %zu, expected %zu in %s\n", err.msg, err.pos, pos, json);
+        assert(0 && "unexpected error position");
+    }
+    tag_free(src);
+}
+
+int main(void) {
+    check("null", "null");
+    check(" true ", "true");
+    check("[false]", "[false]");
+    check("-0", "0");
+    check("123456789012345678", "123456789012345678");
+    check("-9007199254740993", "-9007199254740993");
+    check("12345678901234567890", "1.2345678901234567e+19");
+    check("[1.5, -2e3, 0.1e-6, 1E+2]", "[1.5,-2000.0,1e-07,100.0]");
+    check("{}", "{}");
+    check("[ [ ], { } ]", "[[],{}]");
+    check("{\"a\": 1, \"b\": [true, null], \"a\": 2}", "{\"a\":2,\"b\":[true,null]}");
+    check("\"a longer string without escapes\"", "\"a longer string without escapes\"");
+    check("\"\\n starts with an escape\"", "\"\\n starts with an escape\"");
+    check("\"tab\\tquote\\\"slash\\/back\\\\\"", "\"tab\\tquote\\\"slash/back\\\\\"");
+    check("\"\\u0041\\u00e9\\u20ac\\ud83d\\ude00\\u0001\"",
+          "\"A\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\\u0001\"");
+    check("{\"a key longer than a short string\": {\"nested\": [1, 2.5, \"x\"]}}",
+          "{\"a key longer than a short string\":{\"nested\":[1,2.5,\"x\"]}}");
+
+    Tag t = parse("{\"items\": [1, 2, 3], \"a key longer than a short string\": \"v\"}");
+    assert(tag_is_table(t) && table_len(tag_to_table(t)) == 2 && "object not parsed");
+    Tag key = tag_intern(str("a key longer than a short string"));
+    Tag val;
+    assert(table_get(tag_to_table(t), key, &val) && tag_eq(val, short_str_to_tag("v", 1)) &&
+           "key not found");
+    (void)t, (void)key, (void)val; // unused without asserts
+
+    check_error("", 0);
+    check_error("[1, 2", 5);
+    check_error("{\"a\" 1}", 5);
+    check_error("[01]", 2);
+    check_error("[1.]", 3);
+    check_error("{\"a\": 1,}", 8);
+    check_error("\"\\ud800\"", 1);
+    check_error("\"\\x\"", 1);
+    check_error("\"a\nb\"", 2);
+    check_error("[1] 2", 4);
+    char deep[JSON_MAX_DEPTH + 2] = {0};
+    memset(deep, '[', JSON_MAX_DEPTH + 1);
+    check_error(deep, JSON_MAX_DEPTH);
+
+    list_destroy(&owned);
+    str_intern_destroy();
+    i64_pool_destroy();
+
+#ifdef SLANG_DEBUG
+    assert(mem_stats.bytes == 0 && "unfreed memory");
+#endif
+
+    return EXIT_SUCCESS;
+}
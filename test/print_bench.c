@@ -0,0 +1,63 @@
+#include "mem.h" // mem_stats
+#include "out.h" // Out, out_*
+#include "tag.h" // Tag, *_tag, tag_*
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CYCLES 10000000
+
+static Tag int_num(int64_t i) { return i49_to_tag(i * 7919 - CYCLES); }
+static Tag double_num(int64_t i) { return double_to_tag(i * 0.37 - CYCLES); }
+
+static const struct {
+    const char *name;
+    Tag (*num)(int64_t);
+} numbers[] = {
+    {"ints", int_num},
+    {"doubles", double_num},
+};
+
+// Prints like print(n) did before the output buffer, one stdio call per value and newline.
+static void bench_stdio(FILE *f, const char *name, Tag (*num)(int64_t)) {
+    clock_t start = clock();
+    for (int64_t i = 0; i < CYCLES; i++) {
+        tag_printf(f, num(i));
+        putc('\n', f);
+    }
+    fflush(f);
+    clock_t duration = clock() - start;
+    fprintf(stderr, "stdio %-8s duration:%8lu\n", name, duration);
+}
+
+static void bench_out(FILE *f, const char *name, Tag (*num)(int64_t)) {
+    Out out = out_new(f);
+    clock_t start = clock();
+    for (int64_t i = 0; i < CYCLES; i++) {
+        out_tag(&out, num(i));
+        out_char(&out, '\n');
+    }
+    out_flush(&out);
+    clock_t duration = clock() - start;
+    fprintf(stderr, "out   %-8s duration:%8lu\n", name, duration);
+    out_destroy(&out);
+}
+
+int main(void) {
+    FILE *f = fopen("/dev/null", "w");
+    assert(f && "can't open /dev/null");
+    for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++) {
+        bench_stdio(f, numbers[i].name, numbers[i].num);
+        bench_out(f, numbers[i].name, numbers[i].num);
+    }
+    fclose(f);
+
+#ifdef SLANG_DEBUG
+    assert(mem_stats.bytes == 0 && "unfreed memory");
+#endif
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,49 @@
+#include "mem.h" // mem_stats
+#include "str.h" // Slice, str_build, slice_view
+#include "tag.h" // Tag, tag_*
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void check(Tag t, const char *expected) {
+    Tag want = string_to_tag(string_new(expected, strlen(expected)));
+    if (!tag_eq(t, want)) {
+        fprintf(stderr, "got ");
+        tag_printf(stderr, t);
+        fprintf(stderr, ", expected %s\n", expected);
+        assert(0 && "unexpected string");
+    }
+    tag_free(want);
+}
+
+static Tag str(const char *c) { return string_to_tag(string_new(c, strlen(c))); }
+
+int main(void) {
+    // a concatenation leaves spare capacity at the end of its buffer
+    Slice *s = str_build("aaaaaaaaaabbbbbbbbbb", 20, "cccccccccc", 10);
+    Tag whole = slice_to_tag(s);
+
+    // concatenating onto a suffix view extends the buffer in place, but keeps the view's start
+    Tag suffix = slice_to_tag(slice_view(s, 10, 20));
+    Tag extended = tag_add(suffix, str("XY"));
+    check(extended, "bbbbbbbbbbccccccccccXY");
+    check(whole, "aaaaaaaaaabbbbbbbbbbcccccccccc");
+
+    // the prefix no longer ends at the buffer's tail, so it's copied
+    Tag prefix = slice_to_tag(slice_view(s, 0, 10));
+    Tag copied = tag_add(prefix, str("ZZZZZZ"));
+    check(copied, "aaaaaaaaaaZZZZZZ");
+    check(extended, "bbbbbbbbbbccccccccccXY");
+
+    tag_free(copied);
+    tag_free(extended);
+    tag_free(whole);
+
+#ifdef SLANG_DEBUG
+    assert(mem_stats.bytes == 0 && "unfreed memory");
+#endif
+
+    return EXIT_SUCCESS;
+}
@@ -1,10 +1,12 @@
 #include "list.h"  // List, list_*
 #include "mem.h"   // mem_stats
+#include "str.h"   // String
 #include "table.h" // Table, table_*
 #include "tag.h"   // Tag, *_tag, tag_*
 #include "util.h"  // randint, randstr
 
 #include <inttypes.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -12,59 +14,200 @@
 #define KEYSPACE 10000
 #define STRSIZE 16
 #define CYCLES 10000000
+#define STR_CYCLES 2000000
+#define GROWTH_CYCLES 5000000
+#define SMALL_KEYS 6
+#define SMALL_READS 20
 
-int main(int argc, const char *argv[]) {
-    unsigned long long keyspace = KEYSPACE;
-    if (argc > 1) {
-        keyspace = strtoull(argv[1], NULL, 10);
-        keyspace = keyspace ? keyspace : KEYSPACE;
-    }
+static void print_stats(void) {
+#ifdef SLANG_DEBUG
+    TableStats s = table_stats();
+    fprintf(stderr, "queries:%8" PRIu64 " collisions:%8" PRIu64 " avg probe:%6.3f max probe:%4" PRIu64
+            "\n", s.queries, s.collisions, s.queries ? (double)s.probes / s.queries : 0.0,
+            s.max_probe);
+    table_stats_reset();
+#endif
+}
+
+static Tag sequential_key(int n) { return i49_to_tag(n); }
+static Tag strided_key(int n) { return i49_to_tag((int64_t)n * 4096); }
+static Tag random_key(int n) {
+    // a fixed pseudo-random permutation of the keyspace spread over the whole i49 range
+    return i49_to_tag(((uint64_t)n * UINT64_C(0x9E3779B97F4A7C15) >> 16) % I49_MAX);
+}
+static Tag double_key(int n) { return double_to_tag(n * 0.25 + 0.125); }
+
+static const struct {
+    const char *name;
+    Tag (*key)(int);
+} distributions[] = {
+    {"sequential ints", sequential_key},
+    {"strided ints", strided_key},
+    {"random ints", random_key},
+    {"doubles", double_key},
+};
+
+static void bench_keys(const char *name, Tag (*key)(int), unsigned long long keyspace) {
     srand(1337);
     Table t = (Table){0};
     clock_t start = clock();
     for (unsigned int i = 0; i < CYCLES; i++) {
-        int n = randint(keyspace);
-        Tag key = i49_to_tag(n);
+        Tag k = key(randint(keyspace));
         Tag val = i49_to_tag(i);
-        table_set(&t, key, val);
+        table_set(&t, k, val);
     }
     clock_t duration = clock() - start;
 
-    fprintf(stderr, "pairs\n");
-    fprintf(stderr, "real_len:%8zu duration:%8lu\n", table_len(&t), duration);
-#ifdef SLANG_DEBUG
-    TableStats s1;
-    s1 = table_stats();
-    fprintf(stderr, "queries:%8" PRIu64 " collisions:%8" PRIu64 "\n", s1.queries, s1.collisions);
-#endif
+    fprintf(stderr, "%s\n", name);
+    fprintf(stderr, "real_len:%8zu duration:%8lu bytes:%9zu\n", table_len(&t), duration,
+            table_bytes(&t));
+    print_stats();
     table_destroy(&t);
+}
+
+// Fills keys 0..keyspace-1 in order, which keeps them in the array part, then updates them.
+static void bench_dense(unsigned long long keyspace) {
+    srand(1337);
+    Table t = (Table){0};
+    clock_t start = clock();
+    for (unsigned long long i = 0; i < keyspace; i++) {
+        table_set(&t, i49_to_tag(i), i49_to_tag(i));
+    }
+    for (unsigned int i = 0; i < CYCLES; i++) {
+        table_set(&t, i49_to_tag(randint(keyspace)), i49_to_tag(i));
+    }
+    clock_t duration = clock() - start;
+
+    fprintf(stderr, "dense ints\n");
+    fprintf(stderr, "real_len:%8zu duration:%8lu bytes:%9zu\n", table_len(&t), duration,
+            table_bytes(&t));
+    print_stats();
+    table_destroy(&t);
+}
+
+// Small records: a few string keys set and read many times, like objects in scripts.
+static void bench_small(List *strings) {
+    size_t bytes = 0;
+    clock_t start = clock();
+    for (unsigned int i = 0; i < CYCLES / SMALL_READS; i++) {
+        Table t = (Table){0};
+        for (size_t j = 0; j < SMALL_KEYS; j++) {
+            table_set(&t, tag_to_ref(*list_get(strings, j)), i49_to_tag(j));
+        }
+        for (size_t j = 0; j < SMALL_READS; j++) {
+            Tag val;
+            table_get(&t, *list_get(strings, j % SMALL_KEYS), &val);
+        }
+        bytes = table_bytes(&t);
+        table_destroy(&t);
+    }
+    clock_t duration = clock() - start;
+    fprintf(stderr, "small tables\n");
+    fprintf(stderr, "real_len:%8d duration:%8lu bytes:%9zu\n", SMALL_KEYS, duration, bytes);
+    print_stats();
+}
+
+// Builds tables from scratch so most of the time goes to growing them. Rehashing reads the
+// hash cached in the entries instead of dereferencing every key.
+static void bench_growth(const char *name, List *strings) {
+    size_t len = list_len(strings);
+    clock_t start = clock();
+    size_t bytes = 0;
+    for (unsigned int i = 0; i < GROWTH_CYCLES / len + 1; i++) {
+        Table t = (Table){0};
+        for (size_t j = 0; j < len; j++) {
+            Tag kv = *list_get(strings, j);
+            kv = tag_is_ptr(kv) ? tag_to_ref(kv) : kv;
+            table_set(&t, kv, kv);
+        }
+        bytes = table_bytes(&t);
+        table_destroy(&t);
+    }
+    clock_t duration = clock() - start;
+    fprintf(stderr, "growth with %s\n", name);
+    fprintf(stderr, "real_len:%8zu duration:%8lu bytes:%9zu\n", len, duration, bytes);
+    print_stats();
+}
+
+static const size_t str_key_sizes[] = {8, 16, 32, 64, 256, 1024};
+
+// Sets string keys of one length. Clearing the cached hash before each lookup makes every
+// operation hash the full key, like first-time lookups of freshly concatenated strings do.
+static void bench_str_keys(size_t size, unsigned long long keyspace) {
+    List strings = {0};
+    for (size_t i = 0; i < keyspace; i++) {
+        list_append(&strings, randstr(size));
+    }
+    Table t = (Table){0};
+    srand(1337);
+    clock_t start = clock();
+    for (unsigned int i = 0; i < STR_CYCLES; i++) {
+        int n = randint(keyspace);
+        Tag kv = tag_to_ref(*list_get(&strings, n));
+        tag_to_string(kv)->hash = 0;
+        table_set(&t, kv, kv);
+    }
+    clock_t duration = clock() - start;
+    fprintf(stderr, "strings of %4zu bytes real_len:%8zu duration:%8lu bytes:%9zu\n", size,
+            table_len(&t), duration, table_bytes(&t));
+    print_stats();
+    table_destroy(&t);
+    list_destroy(&strings);
+}
+
+int main(int argc, const char *argv[]) {
+    unsigned long long keyspace = KEYSPACE;
+    if (argc > 1) {
+        keyspace = strtoull(argv[1], NULL, 10);
+        keyspace = keyspace ? keyspace : KEYSPACE;
+    }
+    for (size_t i = 0; i < sizeof(distributions) / sizeof(distributions[0]); i++) {
+        bench_keys(distributions[i].name, distributions[i].key, keyspace);
+    }
+    bench_dense(keyspace);
 
     List strings = {0};
     for (size_t i = 0; i < keyspace; i++) {
         list_append(&strings, randstr(STRSIZE));
     }
 
-    t = (Table){0};
+    Table t = (Table){0};
     srand(1337);
-    start = clock();
+    clock_t start = clock();
     for (unsigned int i = 0; i < CYCLES; i++) {
         int n = randint(keyspace);
         Tag kv = tag_to_ref(*list_get(&strings, n));
         table_set(&t, kv, kv);
     }
-    duration = clock() - start;
+    clock_t duration = clock() - start;
 
     fprintf(stderr, "slices\n");
-    fprintf(stderr, "real_len:%8zu duration:%8lu\n", table_len(&t), duration);
-#ifdef SLANG_DEBUG
-    TableStats s2;
-    s2 = table_stats();
-    fprintf(stderr, "queries:%8" PRIu64 " collisions:%8" PRIu64 "\n", s2.queries - s1.queries,
-            s2.collisions - s1.collisions);
-#endif
+    fprintf(stderr, "real_len:%8zu duration:%8lu bytes:%9zu\n", table_len(&t), duration,
+            table_bytes(&t));
+    print_stats();
     table_destroy(&t);
+
+    bench_small(&strings);
+    bench_growth("strings", &strings);
     list_destroy(&strings);
 
+    // short strings are packed in the tag and don't cache their hash
+    List short_strings = {0};
+    for (size_t i = 0; i < keyspace; i++) {
+        char buf[SHORT_STR_MAX];
+        for (size_t j = 0; j < SHORT_STR_MAX; j++) {
+            buf[j] = charset[randint(sizeof(charset) - 1)];
+        }
+        list_append(&short_strings, short_str_to_tag(buf, SHORT_STR_MAX));
+    }
+    bench_growth("short strings", &short_strings);
+    list_destroy(&short_strings);
+
+    fprintf(stderr, "uncached string hashes\n");
+    for (size_t i = 0; i < sizeof(str_key_sizes) / sizeof(str_key_sizes[0]); i++) {
+        bench_str_keys(str_key_sizes[i], keyspace);
+    }
+
 #ifdef SLANG_DEBUG
     assert(mem_stats.bytes == 0 && "unfreed memory");
 #endif
@@ -0,0 +1,100 @@
+#include "mem.h"   // mem_stats
+#include "table.h" // Table, table_*
+#include "tag.h"   // Tag, *_tag
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define WINDOW 10000
+#define ROUNDS 20
+#define DRAIN_STEPS 8
+#define LIFO_BASE 90
+#define LIFO_BATCH 21
+#define LIFO_ROUNDS 5000
+
+// Reports are printed every WINDOW operations, so the probe stats cover the last window only.
+static void report(const char *phase, size_t ops, const Table *t, clock_t start) {
+    fprintf(stderr, "%-6s ops:%9zu real_len:%8zu bytes:%9zu duration:%8lu", phase, ops,
+            table_len(t), table_bytes(t), (unsigned long)(clock() - start));
+#ifdef SLANG_DEBUG
+    TableStats s = table_stats();
+    fprintf(stderr, " avg probe:%6.3f max probe:%4" PRIu64,
+            s.queries ? (double)s.probes / s.queries : 0.0, s.max_probe);
+    table_stats_reset();
+#endif
+    fputc('\n', stderr);
+}
+
+// Pushes batches of new keys onto a table and deletes them newest first, like a stack. The deletes
+// drop the trailing entries, but their index slots can stay deleted, and those must not use up
+// the empty slots. These sizes used up every empty slot of a 128-slot index, and hung lookups,
+// before deleted slots counted toward the resize trigger.
+static void lifo(void) {
+    Table t = (Table){0};
+    // negative keys skip the array part
+    for (int64_t k = 1; k <= LIFO_BASE; k++) {
+        table_set(&t, i49_to_tag(-k), i49_to_tag(-k));
+    }
+    int64_t next = 0;
+    clock_t start = clock();
+    for (int round = 1; round <= LIFO_ROUNDS; round++) {
+        for (int64_t k = 0; k < LIFO_BATCH; k++) {
+            table_set(&t, i49_to_tag(next + k), i49_to_tag(next + k));
+        }
+        for (int64_t k = LIFO_BATCH - 1; k >= 0; k--) {
+            table_del(&t, i49_to_tag(next + k));
+        }
+        next += LIFO_BATCH;
+    }
+    report("lifo", 2 * LIFO_BATCH * LIFO_ROUNDS, &t, start);
+    table_destroy(&t);
+}
+
+// Simulates a cache: fill a window of keys, then keep inserting new keys while evicting the
+// oldest ones, then drain it. Probe length and memory should stay flat during the churn and
+// memory should follow the live entries down during the drain.
+int main(int argc, const char *argv[]) {
+    unsigned long long window = WINDOW;
+    if (argc > 1) {
+        window = strtoull(argv[1], NULL, 10);
+        window = window ? window : WINDOW;
+    }
+    Table t = (Table){0};
+    clock_t start = clock();
+    int64_t next = 0;
+    int64_t oldest = 0;
+    for (; (uint64_t)next < window; next++) {
+        table_set(&t, i49_to_tag(next), i49_to_tag(next));
+    }
+    report("fill", window, &t, start);
+
+    for (int round = 1; round <= ROUNDS; round++) {
+        start = clock();
+        for (unsigned long long i = 0; i < window; i++) {
+            table_set(&t, i49_to_tag(next), i49_to_tag(next));
+            next++;
+            table_del(&t, i49_to_tag(oldest++));
+        }
+        report("churn", round * window, &t, start);
+    }
+
+    for (int step = 1; step <= DRAIN_STEPS; step++) {
+        start = clock();
+        size_t keep = table_len(&t) / 2;
+        while (table_len(&t) > keep) {
+            table_del(&t, i49_to_tag(oldest++));
+        }
+        report("drain", window - table_len(&t), &t, start);
+    }
+
+    table_destroy(&t);
+    lifo();
+#ifdef SLANG_DEBUG
+    assert(mem_stats.bytes == 0 && "unfreed memory");
+#endif
+
+    return EXIT_SUCCESS;
+}
@@ -15,20 +15,22 @@
 #define ITER 10000
 #define DEL 3
 
-void testone(bool summary) {
+// Int keys run through the table's array part until a delete from the middle moves them.
+void testone(bool summary, bool ints) {
     List keys = {0};
     List vals = {0};
     Table table = {0};
 
     for (size_t i = 0; i < ELEMS; i++) {
-        list_append(&keys, randstr(STRSIZE));
+        list_append(&keys, ints ? i49_to_tag(i) : randstr(STRSIZE));
         list_append(&vals, TAG_NIL);
     }
 
     for (size_t i = 0; i < ITER; i++) {
         size_t idx = randint(ELEMS);
 
-        Tag key = tag_to_ref(*list_get(&keys, idx));
+        Tag key = *list_get(&keys, idx);
+        key = ints ? key : tag_to_ref(key);
         if (randint(DEL) == 0) {
             table_del(&table, key);
             *list_get(&vals, idx) = TAG_NIL;
@@ -39,6 +41,9 @@ void testone(bool summary) {
         }
     }
 
+    // half the runs check the lookups on the frozen table
+    bool frozen = randint(2) == 0 && table_freeze(&table);
+
     for (size_t i = 0; i < ELEMS; i++) {
         Tag key = *list_get(&keys, i);
         Tag expected_val = *list_get(&vals, i);
@@ -56,7 +61,17 @@ void testone(bool summary) {
         Tag val = *list_get(&vals, i);
         expected_len += tag_type(val) == TYPE_I49P;
     }
-    assert(table.real_len == expected_len && "length doesn't match");
+    assert(table_len(&table) == expected_len && "length doesn't match");
+
+    if (frozen) {
+        // writes to a table that shares the entries leave them untouched
+        Table copy;
+        table_share(&copy, &table);
+        table_set(&copy, i49_to_tag(-1), TAG_NIL);
+        assert(table_len(&copy) == expected_len + 1 && "copy length doesn't match");
+        assert(!table_get(&table, i49_to_tag(-1), 0) && "write to a shared table");
+        table_destroy(&copy);
+    }
 
 #ifdef SLANG_DEBUG
     if (summary) {
@@ -79,7 +94,7 @@ int main(void) {
     while (1) {
         i++;
         bool summary = i % 1000 == 0;
-        testone(summary);
+        testone(summary, i % 2);
         if (summary) {
             printf("runs: %" PRIu64 "\n", i);
         }
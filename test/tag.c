@@ -3,19 +3,23 @@
 #include <stdlib.h>
 
 struct String {
-    char _;
+    max_align_t _;
 };
 
 struct Table {
-    char _;
+    max_align_t _;
 };
 
 struct List {
-    char _;
+    max_align_t _;
 };
 
 struct Slice {
-    char _;
+    max_align_t _;
+};
+
+struct Range {
+    max_align_t _;
 };
 
 int main(void) {
@@ -63,6 +67,16 @@ int main(void) {
     assert(!tag_is_data(t) && "slice data check");
     assert(tag_is_own(t) && "slice pointer ownership check");
 
+    struct Range range;
+    t = range_to_tag(&range);
+    assert(tag_is_range(t) && "range check");
+    assert((tag_to_range(t) == &range) && "range conversion");
+    assert(tag_is_ptr(t) && "range pointer check");
+    assert(!tag_is_data(t) && "range data check");
+    assert(tag_is_own(t) && "range pointer ownership check");
+    assert(tag_type(t) == TYPE_RANGE && "range type");
+    assert(tag_type(double_to_tag(double_)) == TYPE_DOUBLE && "double type");
+
     t = i49_to_tag(7);
     assert(tag_is_i49(t) && "positive i49 check");
     assert((tag_to_i49(t) == 7) && "positive i49 conversion");
@@ -88,6 +102,18 @@ int main(void) {
     t = int_to_tag(I49_MIN - 1);
     assert(tag_is_i64(t) && "I49_MIN check");
 
+    t = short_str_to_tag("abc", 3);
+    assert(tag_is_short_str(t) && "short string check");
+    assert(!tag_is_ptr(t) && "short string pointer check");
+    assert(tag_is_data(t) && "short string data check");
+    assert(tag_type(t) == TYPE_SHORT_STR && "short string type");
+    assert(short_str_len(t) == 3 && "short string length");
+    char buf[SHORT_STR_MAX];
+    assert(short_str_chars(t, buf) == 3 && buf[0] == 'a' && buf[2] == 'c' && "short string chars");
+    assert(tag_biteq(t, short_str_to_tag("abc", 3)) && "short string bit-wise equality");
+    assert(!tag_biteq(t, short_str_to_tag("ab", 2)) && "short string prefix inequality");
+    assert(short_str_len(short_str_to_tag("", 0)) == 0 && "empty short string");
+
     assert(tag_is_symbol(TAG_FALSE) && "false symbol check");
     assert(!tag_is_ptr(TAG_FALSE) && "false pointer check");
     assert(tag_is_data(TAG_FALSE) && "false data check");
@@ -0,0 +1,364 @@
+#include "dtoa.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The shortest digits come from Grisu3 (Loitsch, "Printing Floating-Point Numbers Quickly and
+// Accurately with Integers", 2010), following double-conversion. It scales the double and the
+// bounds of its rounding interval by a cached power of ten, so that the digits can be cut from a
+// 64-bit fixed point number. About 0.5% of the doubles are too close to call with 64 bits, Grisu3
+// detects them and those go through printf and strtod instead.
+
+typedef struct {
+    uint64_t f;
+    int e;
+} Fp; // f * 2^e
+
+static Fp fp_mul(Fp x, Fp y) {
+    // the upper 64 bits of the 128-bit product, rounded
+    uint64_t a = x.f >> 32, b = x.f & 0xffffffff;
+    uint64_t c = y.f >> 32, d = y.f & 0xffffffff;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t mid = (bd >> 32) + (ad & 0xffffffff) + (bc & 0xffffffff) + (UINT64_C(1) << 31);
+    return (Fp){.f = ac + (ad >> 32) + (bc >> 32) + (mid >> 32), .e = x.e + y.e + 64};
+}
+
+static Fp fp_normalize(Fp x) {
+    while (!(x.f & (UINT64_C(1) << 63))) {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+// 10^k for k = -348, -340, ... 340, with normalized 64-bit significands
+static const struct {
+    uint64_t f;
+    int16_t e;
+    int16_t k;
+} powers[] = {
+    {UINT64_C(0xfa8fd5a0081c0288), -1220, -348},
+    {UINT64_C(0xbaaee17fa23ebf76), -1193, -340},
+    {UINT64_C(0x8b16fb203055ac76), -1166, -332},
+    {UINT64_C(0xcf42894a5dce35ea), -1140, -324},
+    {UINT64_C(0x9a6bb0aa55653b2d), -1113, -316},
+    {UINT64_C(0xe61acf033d1a45df), -1087, -308},
+    {UINT64_C(0xab70fe17c79ac6ca), -1060, -300},
+    {UINT64_C(0xff77b1fcbebcdc4f), -1034, -292},
+    {UINT64_C(0xbe5691ef416bd60c), -1007, -284},
+    {UINT64_C(0x8dd01fad907ffc3c), -980, -276},
+    {UINT64_C(0xd3515c2831559a83), -954, -268},
+    {UINT64_C(0x9d71ac8fada6c9b5), -927, -260},
+    {UINT64_C(0xea9c227723ee8bcb), -901, -252},
+    {UINT64_C(0xaecc49914078536d), -874, -244},
+    {UINT64_C(0x823c12795db6ce57), -847, -236},
+    {UINT64_C(0xc21094364dfb5637), -821, -228},
+    {UINT64_C(0x9096ea6f3848984f), -794, -220},
+    {UINT64_C(0xd77485cb25823ac7), -768, -212},
+    {UINT64_C(0xa086cfcd97bf97f4), -741, -204},
+    {UINT64_C(0xef340a98172aace5), -715, -196},
+    {UINT64_C(0xb23867fb2a35b28e), -688, -188},
+    {UINT64_C(0x84c8d4dfd2c63f3b), -661, -180},
+    {UINT64_C(0xc5dd44271ad3cdba), -635, -172},
+    {UINT64_C(0x936b9fcebb25c996), -608, -164},
+    {UINT64_C(0xdbac6c247d62a584), -582, -156},
+    {UINT64_C(0xa3ab66580d5fdaf6), -555, -148},
+    {UINT64_C(0xf3e2f893dec3f126), -529, -140},
+    {UINT64_C(0xb5b5ada8aaff80b8), -502, -132},
+    {UINT64_C(0x87625f056c7c4a8b), -475, -124},
+    {UINT64_C(0xc9bcff6034c13053), -449, -116},
+    {UINT64_C(0x964e858c91ba2655), -422, -108},
+    {UINT64_C(0xdff9772470297ebd), -396, -100},
+    {UINT64_C(0xa6dfbd9fb8e5b88f), -369, -92},
+    {UINT64_C(0xf8a95fcf88747d94), -343, -84},
+    {UINT64_C(0xb94470938fa89bcf), -316, -76},
+    {UINT64_C(0x8a08f0f8bf0f156b), -289, -68},
+    {UINT64_C(0xcdb02555653131b6), -263, -60},
+    {UINT64_C(0x993fe2c6d07b7fac), -236, -52},
+    {UINT64_C(0xe45c10c42a2b3b06), -210, -44},
+    {UINT64_C(0xaa242499697392d3), -183, -36},
+    {UINT64_C(0xfd87b5f28300ca0e), -157, -28},
+    {UINT64_C(0xbce5086492111aeb), -130, -20},
+    {UINT64_C(0x8cbccc096f5088cc), -103, -12},
+    {UINT64_C(0xd1b71758e219652c), -77, -4},
+    {UINT64_C(0x9c40000000000000), -50, 4},
+    {UINT64_C(0xe8d4a51000000000), -24, 12},
+    {UINT64_C(0xad78ebc5ac620000), 3, 20},
+    {UINT64_C(0x813f3978f8940984), 30, 28},
+    {UINT64_C(0xc097ce7bc90715b3), 56, 36},
+    {UINT64_C(0x8f7e32ce7bea5c70), 83, 44},
+    {UINT64_C(0xd5d238a4abe98068), 109, 52},
+    {UINT64_C(0x9f4f2726179a2245), 136, 60},
+    {UINT64_C(0xed63a231d4c4fb27), 162, 68},
+    {UINT64_C(0xb0de65388cc8ada8), 189, 76},
+    {UINT64_C(0x83c7088e1aab65db), 216, 84},
+    {UINT64_C(0xc45d1df942711d9a), 242, 92},
+    {UINT64_C(0x924d692ca61be758), 269, 100},
+    {UINT64_C(0xda01ee641a708dea), 295, 108},
+    {UINT64_C(0xa26da3999aef774a), 322, 116},
+    {UINT64_C(0xf209787bb47d6b85), 348, 124},
+    {UINT64_C(0xb454e4a179dd1877), 375, 132},
+    {UINT64_C(0x865b86925b9bc5c2), 402, 140},
+    {UINT64_C(0xc83553c5c8965d3d), 428, 148},
+    {UINT64_C(0x952ab45cfa97a0b3), 455, 156},
+    {UINT64_C(0xde469fbd99a05fe3), 481, 164},
+    {UINT64_C(0xa59bc234db398c25), 508, 172},
+    {UINT64_C(0xf6c69a72a3989f5c), 534, 180},
+    {UINT64_C(0xb7dcbf5354e9bece), 561, 188},
+    {UINT64_C(0x88fcf317f22241e2), 588, 196},
+    {UINT64_C(0xcc20ce9bd35c78a5), 614, 204},
+    {UINT64_C(0x98165af37b2153df), 641, 212},
+    {UINT64_C(0xe2a0b5dc971f303a), 667, 220},
+    {UINT64_C(0xa8d9d1535ce3b396), 694, 228},
+    {UINT64_C(0xfb9b7cd9a4a7443c), 720, 236},
+    {UINT64_C(0xbb764c4ca7a44410), 747, 244},
+    {UINT64_C(0x8bab8eefb6409c1a), 774, 252},
+    {UINT64_C(0xd01fef10a657842c), 800, 260},
+    {UINT64_C(0x9b10a4e5e9913129), 827, 268},
+    {UINT64_C(0xe7109bfba19c0c9d), 853, 276},
+    {UINT64_C(0xac2820d9623bf429), 880, 284},
+    {UINT64_C(0x80444b5e7aa7cf85), 907, 292},
+    {UINT64_C(0xbf21e44003acdd2d), 933, 300},
+    {UINT64_C(0x8e679c2f5e44ff8f), 960, 308},
+    {UINT64_C(0xd433179d9c8cb841), 986, 316},
+    {UINT64_C(0x9e19db92b4e31ba9), 1013, 324},
+    {UINT64_C(0xeb96bf6ebadf77d9), 1039, 332},
+    {UINT64_C(0xaf87023b9bf0ee6b), 1066, 340},
+};
+
+#define POWERS_MIN_K (-348)
+#define POWERS_STEP_K 8
+// the scaled exponent range that leaves room for the digit generation's 32-bit integral part
+#define MIN_TARGET_E (-60)
+#define MAX_TARGET_E (-32)
+
+// Moves the last digit down while that brings the digits closer to the double, and checks that
+// they're surely within the rounding interval and surely the closest candidate.
+static bool round_weed(char *digits, size_t len, uint64_t distance_too_high_w,
+                       uint64_t unsafe_interval, uint64_t rest, uint64_t ten_kappa, uint64_t unit) {
+    uint64_t small_distance = distance_too_high_w - unit;
+    uint64_t big_distance = distance_too_high_w + unit;
+    while (rest < small_distance && unsafe_interval - rest >= ten_kappa &&
+           (rest + ten_kappa < small_distance ||
+            small_distance - rest >= rest + ten_kappa - small_distance)) {
+        digits[len - 1]--;
+        rest += ten_kappa;
+    }
+    if (rest < big_distance && unsafe_interval - rest >= ten_kappa &&
+        (rest + ten_kappa < big_distance ||
+         big_distance - rest > rest + ten_kappa - big_distance)) {
+        return false;
+    }
+    return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+// Generates the digits of the shortest number between low and high that's closest to w, all three
+// with the same exponent. Fails if 64 bits of precision can't tell which digits that is.
+static bool digit_gen(Fp low, Fp w, Fp high, char *digits, size_t *len, int *kappa) {
+    uint64_t unit = 1;
+    Fp too_low = {.f = low.f - unit, .e = low.e};
+    Fp too_high = {.f = high.f + unit, .e = high.e};
+    uint64_t unsafe_interval = too_high.f - too_low.f;
+    int shift = -w.e;
+    uint64_t one = UINT64_C(1) << shift;
+    uint32_t integrals = (uint32_t)(too_high.f >> shift);
+    uint64_t fractionals = too_high.f & (one - 1);
+
+    uint32_t divisor = 1;
+    *kappa = 1;
+    while (*kappa < 10 && divisor <= integrals / 10) {
+        divisor *= 10;
+        (*kappa)++;
+    }
+    *len = 0;
+    while (*kappa > 0) {
+        digits[(*len)++] = (char)('0' + integrals / divisor);
+        integrals %= divisor;
+        (*kappa)--;
+        uint64_t rest = ((uint64_t)integrals << shift) + fractionals;
+        if (rest < unsafe_interval) {
+            return round_weed(digits, *len, too_high.f - w.f, unsafe_interval, rest,
+                              (uint64_t)divisor << shift, unit);
+        }
+        divisor /= 10;
+    }
+    for (;;) {
+        fractionals *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+        digits[(*len)++] = (char)('0' + (fractionals >> shift));
+        fractionals &= one - 1;
+        (*kappa)--;
+        if (fractionals < unsafe_interval) {
+            return round_weed(digits, *len, (too_high.f - w.f) * unit, unsafe_interval,
+                              fractionals, one, unit);
+        }
+    }
+}
+
+// d is positive and finite, the result is d ~ digits * 10^exp10
+static bool grisu3(double d, char *digits, size_t *len, int *exp10) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    uint64_t fraction = bits & ((UINT64_C(1) << 52) - 1);
+    int biased_e = (int)(bits >> 52);
+    Fp v = biased_e ? (Fp){.f = fraction | (UINT64_C(1) << 52), .e = biased_e - 1075}
+                    : (Fp){.f = fraction, .e = -1074};
+
+    // the rounding interval's bounds are halfway to the neighbouring doubles, and the lower one is
+    // closer for powers of two, except for the smallest normal double
+    Fp plus = fp_normalize((Fp){.f = (v.f << 1) + 1, .e = v.e - 1});
+    bool closer = fraction == 0 && biased_e > 1;
+    Fp minus = closer ? (Fp){.f = (v.f << 2) - 1, .e = v.e - 2}
+                      : (Fp){.f = (v.f << 1) - 1, .e = v.e - 1};
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+    Fp w = fp_normalize(v);
+
+    // the cached power that brings w's exponent into the target range
+    int min_e = MIN_TARGET_E - (w.e + 64);
+    int k = (int)ceil((min_e + 63) * 0.30102999566398114); // log10(2)
+    size_t idx = (size_t)((k - POWERS_MIN_K - 1) / POWERS_STEP_K + 1);
+    assert(idx < sizeof(powers) / sizeof(powers[0]) && "no cached power");
+    Fp c = {.f = powers[idx].f, .e = powers[idx].e};
+    assert(w.e + c.e + 64 >= MIN_TARGET_E && w.e + c.e + 64 <= MAX_TARGET_E && "bad cached power");
+
+    int kappa;
+    bool ok = digit_gen(fp_mul(minus, c), fp_mul(w, c), fp_mul(plus, c), digits, len, &kappa);
+    *exp10 = kappa - powers[idx].k;
+    return ok;
+}
+
+// The shortest precision that round-trips, printf rounds it to the closest digits.
+static void slow_digits(double d, char *digits, size_t *len, int *exp10) {
+    char buf[32];
+    for (int precision = 0; precision < 17; precision++) {
+        snprintf(buf, sizeof(buf), "%.*e", precision, d);
+        if (strtod(buf, 0) == d) {
+            break;
+        }
+    }
+    // buf is d[.ddd]e[+-]dd
+    *len = 0;
+    char *c = buf;
+    for (; *c != 'e'; c++) {
+        if (*c != '.') {
+            digits[(*len)++] = *c;
+        }
+    }
+    *exp10 = atoi(c + 1) - (int)(*len - 1);
+}
+
+static const char digit_pairs[] = "00010203040506070809"
+                                  "10111213141516171819"
+                                  "20212223242526272829"
+                                  "30313233343536373839"
+                                  "40414243444546474849"
+                                  "50515253545556575859"
+                                  "60616263646566676869"
+                                  "70717273747576777879"
+                                  "80818283848586878889"
+                                  "90919293949596979899";
+
+size_t itoa(int64_t i, char *buf) {
+    char digits[ITOA_MAX];
+    char *end = digits + sizeof(digits);
+    char *c = end;
+    // negating the unsigned value keeps INT64_MIN defined
+    uint64_t u = i < 0 ? -(uint64_t)i : (uint64_t)i;
+    while (u >= 100) {
+        c -= 2;
+        memcpy(c, &digit_pairs[(u % 100) * 2], 2);
+        u /= 100;
+    }
+    if (u >= 10) {
+        c -= 2;
+        memcpy(c, &digit_pairs[u * 2], 2);
+    } else {
+        *--c = (char)('0' + u);
+    }
+    if (i < 0) {
+        *--c = '-';
+    }
+    memcpy(buf, c, (size_t)(end - c));
+    return (size_t)(end - c);
+}
+
+static size_t put_exp(char *buf, int e) {
+    size_t len = 0;
+    buf[len++] = 'e';
+    buf[len++] = e < 0 ? '-' : '+';
+    e = abs(e);
+    if (e >= 100) {
+        buf[len++] = (char)('0' + e / 100);
+    }
+    buf[len++] = (char)('0' + e / 10 % 10);
+    buf[len++] = (char)('0' + e % 10);
+    return len;
+}
+
+size_t dtoa(double d, char *buf) {
+    size_t len = 0;
+    if (isnan(d)) {
+        memcpy(buf, "nan", 3);
+        return 3;
+    }
+    if (signbit(d)) {
+        buf[len++] = '-';
+        d = -d;
+    }
+    if (isinf(d)) {
+        memcpy(buf + len, "inf", 3);
+        return len + 3;
+    }
+    if (d == 0) {
+        memcpy(buf + len, "0.0", 3);
+        return len + 3;
+    }
+
+    char digits[18];
+    size_t n;
+    int exp10;
+    if (!grisu3(d, digits, &n, &exp10)) {
+        slow_digits(d, digits, &n, &exp10);
+    }
+    while (n > 1 && digits[n - 1] == '0') {
+        n--;
+        exp10++;
+    }
+
+    int point = (int)n + exp10; // digits before the decimal point
+    if (point - 1 < -4 || point - 1 > 15) {
+        buf[len++] = digits[0];
+        if (n > 1) {
+            buf[len++] = '.';
+            memcpy(buf + len, digits + 1, n - 1);
+            len += n - 1;
+        }
+        return len + put_exp(buf + len, point - 1);
+    }
+    if (point <= 0) {
+        memcpy(buf + len, "0.000", 2 + (size_t)-point);
+        len += 2 + (size_t)-point;
+        memcpy(buf + len, digits, n);
+        return len + n;
+    }
+    if ((size_t)point < n) {
+        memcpy(buf + len, digits, (size_t)point);
+        len += (size_t)point;
+        buf[len++] = '.';
+        memcpy(buf + len, digits + point, n - (size_t)point);
+        return len + n - (size_t)point;
+    }
+    memcpy(buf + len, digits, n);
+    len += n;
+    memset(buf + len, '0', (size_t)point - n);
+    len += (size_t)point - n;
+    memcpy(buf + len, ".0", 2);
+    return len + 2;
+}
@@ -0,0 +1,21 @@
+#ifndef slang_dtoa_h
+#define slang_dtoa_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DTOA_MAX 24 // -1.2345678901234567e-308
+
+// dtoa() writes the shortest string that reads back as d into buf, which must fit at least
+// DTOA_MAX chars, and returns its length. The string isn't null terminated. Like Python's repr(),
+// it uses scientific notation only for exponents below -4 or above 15, and always has a fraction
+// or an exponent to tell it apart from an int: 0.1, 3.0, 1e+16, 1.5e-07, -0.0, inf, nan.
+size_t dtoa(double d, char *buf);
+
+#define ITOA_MAX 20 // -9223372036854775808
+
+// itoa() writes the decimal digits of i into buf, which must fit at least ITOA_MAX chars, and
+// returns their number. The string isn't null terminated.
+size_t itoa(int64_t i, char *buf);
+
+#endif
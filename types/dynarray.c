@@ -38,6 +38,13 @@ void dynarray_reserve_T(DynamicArrayT *array, size_t cap, size_t item_size) {
     array->cap = cap;
 }
 
+// Unlike reserve, resize sets the exact capacity and can shrink the array down to its length.
+void dynarray_resize_T(DynamicArrayT *array, size_t cap, size_t item_size) {
+    assert(cap >= array->len && "dynarray resize below length");
+    array->items = mem_resize_array(array->items, item_size, array->cap, cap);
+    array->cap = cap;
+}
+
 void dynarray_grow_T(DynamicArrayT *array, size_t item_size) {
     size_t new_cap = MIN_CAP;
     if (array->cap && size_t_mul_over(array->cap, 2, &new_cap)) {
@@ -60,7 +67,7 @@ void dynarray_free_T(DynamicArrayT *array, size_t item_size) {
 }
 
 void dynarray_seal_T(DynamicArrayT *array, size_t item_size) {
-    array->items = mem_resize_array(array->items, item_size, array->cap, array->len);
+    dynarray_resize_T(array, array->len, item_size);
 }
 
 // predefined dynamic lists
@@ -12,6 +12,7 @@ typedef struct {
 } DynamicArrayT;
 
 void dynarray_reserve_T(DynamicArrayT *, size_t cap, size_t item_size);
+void dynarray_resize_T(DynamicArrayT *, size_t cap, size_t item_size);
 void dynarray_grow_T(DynamicArrayT *, size_t item_size);
 void dynarray_seal_T(DynamicArrayT *, size_t item_size);
 void dynarray_destroy_T(DynamicArrayT *, size_t item_size);
@@ -20,6 +21,7 @@ void dynarray_free_T(DynamicArrayT *, size_t item_size);
 #define DynamicArray(T) DynamicArray_GEN_##T
 
 #define dynarray_reserve(T) dynarray_reserve_GEN_##T
+#define dynarray_resize(T) dynarray_resize_GEN_##T
 #define dynarray_grow(T) dynarray_grow_GEN_##T
 #define dynarray_len(T) dynarray_len_GEN_##T
 #define dynarray_cap(T) dynarray_cap_GEN_##T
@@ -39,6 +41,10 @@ void dynarray_free_T(DynamicArrayT *, size_t item_size);
         dynarray_reserve_T(&l->array, cap, sizeof(T));                                             \
     }                                                                                              \
                                                                                                    \
+    inline void dynarray_resize(T)(struct DynamicArray(T) * l, size_t cap) {                       \
+        dynarray_resize_T(&l->array, cap, sizeof(T));                                              \
+    }                                                                                              \
+                                                                                                   \
     inline void dynarray_grow(T)(struct DynamicArray(T) * l) {                                     \
         dynarray_grow_T(&l->array, sizeof(T));                                                     \
     }                                                                                              \
@@ -83,6 +89,7 @@ void dynarray_free_T(DynamicArrayT *, size_t item_size);
 
 #define dynarray_define(T)                                                                         \
     extern inline void dynarray_reserve(T)(DynamicArray(T) *, size_t);                             \
+    extern inline void dynarray_resize(T)(DynamicArray(T) *, size_t);                              \
     extern inline void dynarray_grow(T)(DynamicArray(T) *);                                        \
     extern inline size_t dynarray_len(T)(const DynamicArray(T) *);                                 \
     extern inline size_t dynarray_cap(T)(const DynamicArray(T) *);                                 \
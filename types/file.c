@@ -0,0 +1,119 @@
+#include "file.h"
+
+#include "mem.h" // mem_*
+#include "str.h" // Slice, StrBuf, strbuf_slice, slice_view
+#include "tag.h" // Tag, short_str_to_tag, slice_to_tag
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define FILE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static Slice *empty_slice(void) {
+    Slice *s = mem_allocate(sizeof(*s));
+    *s = (Slice){.c = ""};
+    return s;
+}
+
+#ifdef FILE_MMAP
+
+Slice *file_map(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    int err = fstat(fd, &st) != 0 ? errno : S_ISDIR(st.st_mode) ? EISDIR : 0;
+    if (!err && !S_ISREG(st.st_mode)) {
+        err = EINVAL; // pipes and devices have no size to map
+    }
+    if (err) {
+        close(fd);
+        errno = err;
+        return 0;
+    }
+    size_t len = (size_t)st.st_size;
+    if (len == 0) {
+        close(fd);
+        return empty_slice(); // there's nothing to map
+    }
+    char *c = mmap(0, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    err = errno;
+    close(fd); // the mapping stays valid
+    if (c == MAP_FAILED) {
+        errno = err;
+        return 0;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(c, len, MADV_SEQUENTIAL); // read ahead more aggressively, it's only a hint
+#endif
+    StrBuf *b = mem_allocate(sizeof(*b));
+    *b = (StrBuf){.len = len, .cap = len, .c = c, .mapped = true};
+    return strbuf_slice(b);
+}
+
+void file_unmap(char *c, size_t len) { munmap(c, len); }
+
+#else
+
+Slice *file_map(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return 0;
+    }
+    long len = -1;
+    if (fseek(f, 0L, SEEK_END) == 0) {
+        len = ftell(f);
+    }
+    if (len < 0 || fseek(f, 0L, SEEK_SET) != 0) {
+        fclose(f);
+        return 0;
+    }
+    if (len == 0) {
+        fclose(f);
+        return empty_slice();
+    }
+    StrBuf *b = mem_allocate(sizeof(*b));
+    *b = (StrBuf){.len = (size_t)len, .cap = (size_t)len};
+    b->c = mem_resize_array(0, sizeof(b->c[0]), 0, b->cap);
+    size_t read = fread(b->c, sizeof(b->c[0]), b->len, f);
+    fclose(f);
+    if (read < b->len) {
+        mem_free_array(b->c, sizeof(b->c[0]), b->cap);
+        mem_free(b, sizeof(*b));
+        errno = EIO;
+        return 0;
+    }
+    return strbuf_slice(b);
+}
+
+void file_unmap(char *c, size_t len) {
+    (void)c;
+    (void)len;
+    assert(0 && "no mappings without mmap");
+}
+
+#endif
+
+Tag file_line(const Slice *s, size_t *pos) {
+    assert(*pos < s->len && "line past the end");
+    const char *start = s->c + *pos;
+    size_t rest = s->len - *pos;
+    const char *nl = memchr(start, '\n', rest);
+    size_t len = nl ? (size_t)(nl - start) : rest;
+    size_t offset = *pos;
+    *pos += nl ? len + 1 : len;
+    if (len <= SHORT_STR_MAX) {
+        return short_str_to_tag(start, len);
+    }
+    return slice_to_tag(slice_view(s, offset, len));
+}
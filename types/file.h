@@ -0,0 +1,21 @@
+#ifndef slang_file_h
+#define slang_file_h
+
+#include "str.h" // Slice
+#include "tag.h" // Tag
+
+#include <stddef.h>
+
+// file_map() returns the contents of the file at path as a Slice over a read-only memory mapping,
+// or over a copy where mmap isn't available. Slices taken from it share the mapping, which is
+// unmapped when the last of them is freed. Returns 0 and leaves the reason in errno on failure.
+// Truncating a file while it's mapped crashes the reads past its new end.
+Slice *file_map(const char *path);
+void file_unmap(char *, size_t len);
+
+// file_line() returns the line of s that starts at *pos, without its newline, and moves *pos past
+// it. Lines longer than SHORT_STR_MAX are Slices that share s's StrBuf, and *pos must be less than
+// s's length.
+Tag file_line(const Slice *s, size_t *pos);
+
+#endif
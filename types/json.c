@@ -0,0 +1,640 @@
+#include "json.h"
+
+#include "dtoa.h"  // dtoa, itoa
+#include "list.h"  // List, list_*
+#include "mem.h"   // mem_*
+#include "range.h" // Range, range_*
+#include "str.h"   // String, StrBuf, string_new, strbuf_slice
+#include "table.h" // Table, table_*
+#include "tag.h"   // Tag, tag_*, str_view
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Strings are scanned a word at a time for the chars that end a run of plain chars: quotes,
+// backslashes and control chars. The word tests can report false positives, but only above a
+// true one, so the word that fails them is rescanned char by char.
+#define ONES ((uint64_t)0x0101010101010101)
+#define HIGHS (ONES * 0x80)
+#define HAS_ZERO(w) (((w) - ONES) & ~(w) & HIGHS)
+#define HAS_LESS(w, n) (((w) - ONES * (n)) & ~(w) & HIGHS)
+
+static bool is_special(char c) { return c == '"' || c == '\\' || (unsigned char)c < 0x20; }
+
+// returns the first quote, backslash or control char at or after c, or end
+static const char *scan_string(const char *c, const char *end) {
+    for (; end - c >= 8; c += 8) {
+        uint64_t w;
+        memcpy(&w, c, sizeof(w));
+        if (HAS_ZERO(w ^ (ONES * '"')) | HAS_ZERO(w ^ (ONES * '\\')) | HAS_LESS(w, 0x20)) {
+            break;
+        }
+    }
+    for (; c < end && !is_special(*c); c++) {
+    }
+    return c;
+}
+
+typedef struct Parser {
+    const char *start;
+    const char *c;
+    const char *end;
+    Tag src;
+    List *owned;
+    List stack; // the items of the unfinished containers, which are sized once they're complete
+    char *buf;  // the decoded chars of strings with escapes
+    size_t buf_cap;
+    size_t depth;
+    JsonError *err;
+} Parser;
+
+static bool fail(Parser *p, const char *msg) {
+    *p->err = (JsonError){.msg = p->c < p->end ? msg : "unexpected end of input"};
+    p->err->pos = p->c - p->start;
+    return false;
+}
+
+static Tag own(Parser *p, Tag t) {
+    if (!tag_is_own(t)) {
+        return t;
+    }
+    list_append(p->owned, t);
+    return tag_to_ref(t);
+}
+
+static void skip_space(Parser *p) {
+    for (; p->c < p->end; p->c++) {
+        char c = *p->c;
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+            break;
+        }
+    }
+}
+
+// returns room for len more chars after the first used chars of the buffer
+static char *reserve(Parser *p, size_t used, size_t len) {
+    if (p->buf_cap - used < len) {
+        size_t cap = p->buf_cap ? p->buf_cap : 64;
+        while (cap - used < len) {
+            cap *= 2;
+        }
+        p->buf = mem_resize_array(p->buf, sizeof(p->buf[0]), p->buf_cap, cap);
+        p->buf_cap = cap;
+    }
+    return p->buf + used;
+}
+
+// returns the 4 hex digits at c, or -1
+static int32_t hex4(const char *c) {
+    int32_t n = 0;
+    for (int i = 0; i < 4; i++) {
+        char h = c[i];
+        int32_t digit = h >= '0' && h <= '9'   ? h - '0'
+                        : h >= 'a' && h <= 'f' ? h - 'a' + 10
+                        : h >= 'A' && h <= 'F' ? h - 'A' + 10
+                                               : -1;
+        if (digit < 0) {
+            return -1;
+        }
+        n = n * 16 + digit;
+    }
+    return n;
+}
+
+static size_t utf8(uint32_t cp, char *dst) {
+    if (cp < 0x80) {
+        dst[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        dst[0] = (char)(0xc0 | cp >> 6);
+        dst[1] = (char)(0x80 | (cp & 0x3f));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        dst[0] = (char)(0xe0 | cp >> 12);
+        dst[1] = (char)(0x80 | (cp >> 6 & 0x3f));
+        dst[2] = (char)(0x80 | (cp & 0x3f));
+        return 3;
+    }
+    dst[0] = (char)(0xf0 | cp >> 18);
+    dst[1] = (char)(0x80 | (cp >> 12 & 0x3f));
+    dst[2] = (char)(0x80 | (cp >> 6 & 0x3f));
+    dst[3] = (char)(0x80 | (cp & 0x3f));
+    return 4;
+}
+
+// decodes the escape at p->c into dst, which must fit at least 4 chars, and returns its length
+static bool parse_escape(Parser *p, char *dst, size_t *len) {
+    const char *c = p->c;
+    if (p->end - c < 2) {
+        p->c = p->end;
+        return fail(p, 0);
+    }
+    static const char escapes[][2] = {
+        {'"', '"'}, {'\\', '\\'}, {'/', '/'}, {'b', '\b'},
+        {'f', '\f'}, {'n', '\n'}, {'r', '\r'}, {'t', '\t'},
+    };
+    for (size_t i = 0; i < sizeof(escapes) / sizeof(escapes[0]); i++) {
+        if (c[1] == escapes[i][0]) {
+            dst[0] = escapes[i][1];
+            *len = 1;
+            p->c += 2;
+            return true;
+        }
+    }
+    if (c[1] != 'u') {
+        return fail(p, "invalid escape");
+    }
+    int32_t cp = p->end - c >= 6 ? hex4(c + 2) : -1;
+    if (cp < 0) {
+        return fail(p, "invalid unicode escape");
+    }
+    if (cp >= 0xdc00 && cp < 0xe000) {
+        return fail(p, "unpaired surrogate");
+    }
+    if (cp >= 0xd800 && cp < 0xdc00) {
+        // chars above the first plane are escaped as a pair of surrogates
+        int32_t low = p->end - c >= 12 && c[6] == '\\' && c[7] == 'u' ? hex4(c + 8) : -1;
+        if (low < 0xdc00 || low >= 0xe000) {
+            return fail(p, "unpaired surrogate");
+        }
+        cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+        p->c += 6;
+    }
+    p->c += 6;
+    *len = utf8((uint32_t)cp, dst);
+    return true;
+}
+
+// Strings without escapes are views of the source, and the others are decoded into the parser's
+// buffer first.
+static bool parse_string(Parser *p, Tag *result) {
+    const char *c = ++p->c; // skip the opening quote
+    const char *special = scan_string(c, p->end);
+    if (special < p->end && *special == '"') {
+        p->c = special + 1;
+        size_t len = special - c;
+        *result = own(p, str_view(p->src, c, len));
+        return true;
+    }
+    size_t len = 0;
+    for (;;) {
+        if (special > c) { // the buffer is null until the first reserve
+            memcpy(reserve(p, len, special - c), c, special - c);
+            len += special - c;
+        }
+        p->c = special;
+        if (special == p->end) {
+            return fail(p, 0);
+        }
+        if (*special == '"') {
+            break;
+        }
+        if (*special != '\\') {
+            return fail(p, "control character in string");
+        }
+        size_t escaped;
+        if (!parse_escape(p, reserve(p, len, 4), &escaped)) {
+            return false;
+        }
+        len += escaped;
+        c = p->c;
+        special = scan_string(c, p->end);
+    }
+    p->c++;
+    if (len <= SHORT_STR_MAX) {
+        *result = short_str_to_tag(p->buf, len);
+    } else {
+        *result = own(p, string_to_tag(string_new(p->buf, len)));
+    }
+    return true;
+}
+
+static bool is_digit(const Parser *p, const char *c) {
+    return c < p->end && *c >= '0' && *c <= '9';
+}
+
+static const char *skip_digits(const Parser *p, const char *c) {
+    for (; is_digit(p, c); c++) {
+    }
+    return c;
+}
+
+// Ints with up to 18 digits always fit an int64 and are parsed directly, while longer ints and
+// numbers with a fraction or an exponent become doubles.
+static bool parse_number(Parser *p, Tag *result) {
+    const char *c = p->c;
+    bool negative = *c == '-';
+    c += negative;
+    const char *digits = c;
+    if (!is_digit(p, c)) {
+        p->c = c;
+        return fail(p, "invalid number");
+    }
+    c = *c == '0' ? c + 1 : skip_digits(p, c);
+    const char *digits_end = c;
+    if (c < p->end && *c == '.') {
+        if (!is_digit(p, ++c)) {
+            p->c = c;
+            return fail(p, "invalid number");
+        }
+        c = skip_digits(p, c);
+    }
+    if (c < p->end && (*c == 'e' || *c == 'E')) {
+        c++;
+        c += c < p->end && (*c == '+' || *c == '-');
+        if (!is_digit(p, c)) {
+            p->c = c;
+            return fail(p, "invalid number");
+        }
+        c = skip_digits(p, c);
+    }
+    if (c == digits_end && digits_end - digits <= 18) {
+        int64_t i = 0;
+        for (const char *d = digits; d < digits_end; d++) {
+            i = i * 10 + (*d - '0');
+        }
+        p->c = c;
+        *result = own(p, int_to_tag(negative ? -i : i));
+        return true;
+    }
+    // strtod needs a terminated string
+    char buf[64];
+    size_t len = c - p->c;
+    char *copy = len < sizeof(buf) ? buf : mem_allocate(len + 1);
+    memcpy(copy, p->c, len);
+    copy[len] = '\0';
+    *result = double_to_tag(strtod(copy, 0));
+    if (copy != buf) {
+        mem_free(copy, len + 1);
+    }
+    p->c = c;
+    return true;
+}
+
+static bool parse_literal(Parser *p, const char *word, Tag t, Tag *result) {
+    size_t len = strlen(word);
+    if ((size_t)(p->end - p->c) < len || memcmp(p->c, word, len) != 0) {
+        return fail(p, "unexpected character");
+    }
+    p->c += len;
+    *result = t;
+    return true;
+}
+
+static bool parse_value(Parser *, Tag *);
+
+// consumes the opening bracket or brace of a container, and returns true if it's empty
+static bool open_container(Parser *p, char close, bool *empty) {
+    if (++p->depth > JSON_MAX_DEPTH) {
+        return fail(p, "too deeply nested");
+    }
+    p->c++;
+    skip_space(p);
+    *empty = p->c < p->end && *p->c == close;
+    p->c += *empty;
+    return true;
+}
+
+// consumes the comma or the closing bracket or brace after an item
+static bool next_item(Parser *p, char close, bool *more) {
+    skip_space(p);
+    if (p->c < p->end && (*p->c == ',' || *p->c == close)) {
+        *more = *p->c++ == ',';
+        return true;
+    }
+    return fail(p, close == ']' ? "expected ',' or ']'" : "expected ',' or '}'");
+}
+
+static bool parse_array(Parser *p, Tag *result) {
+    size_t first = list_len(&p->stack);
+    bool empty, more = true;
+    if (!open_container(p, ']', &empty)) {
+        return false;
+    }
+    while (!empty && more) {
+        Tag item;
+        if (!parse_value(p, &item)) {
+            return false;
+        }
+        list_append(&p->stack, item);
+        if (!next_item(p, ']', &more)) {
+            return false;
+        }
+    }
+    size_t len = list_len(&p->stack) - first;
+    List *l = mem_allocate(sizeof(*l));
+    *l = (List){.kind = LIST_NEW};
+    if (len) {
+        dynarray_resize(Tag)(&l->array, len);
+    }
+    for (size_t i = first; i < first + len; i++) {
+        list_push(l, *list_get(&p->stack, i), p->owned);
+    }
+    list_trunc(&p->stack, first);
+    p->depth--;
+    *result = own(p, list_to_tag(l));
+    return true;
+}
+
+static bool parse_object(Parser *p, Tag *result) {
+    size_t first = list_len(&p->stack);
+    bool empty, more = true;
+    if (!open_container(p, '}', &empty)) {
+        return false;
+    }
+    while (!empty && more) {
+        skip_space(p);
+        if (p->c == p->end || *p->c != '"') {
+            return fail(p, "expected a string key");
+        }
+        Tag key, val;
+        if (!parse_string(p, &key)) {
+            return false;
+        }
+        skip_space(p);
+        if (p->c == p->end || *p->c != ':') {
+            return fail(p, "expected ':'");
+        }
+        p->c++;
+        if (!parse_value(p, &val)) {
+            return false;
+        }
+        list_append(&p->stack, key);
+        list_append(&p->stack, val);
+        if (!next_item(p, '}', &more)) {
+            return false;
+        }
+    }
+    size_t len = (list_len(&p->stack) - first) / 2;
+    Table *t = mem_allocate(sizeof(*t));
+    *t = (Table){0};
+    table_reserve(t, len);
+    for (size_t i = first; i < first + 2 * len; i += 2) {
+        // the last of duplicate keys wins
+        table_set(t, *list_get(&p->stack, i), *list_get(&p->stack, i + 1));
+    }
+    list_trunc(&p->stack, first);
+    p->depth--;
+    *result = own(p, table_to_tag(t));
+    return true;
+}
+
+static bool parse_value(Parser *p, Tag *result) {
+    skip_space(p);
+    if (p->c == p->end) {
+        return fail(p, 0);
+    }
+    switch (*p->c) {
+    case '{':
+        return parse_object(p, result);
+    case '[':
+        return parse_array(p, result);
+    case '"':
+        return parse_string(p, result);
+    case 't':
+        return parse_literal(p, "true", TAG_TRUE, result);
+    case 'f':
+        return parse_literal(p, "false", TAG_FALSE, result);
+    case 'n':
+        return parse_literal(p, "null", TAG_NIL, result);
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+        return parse_number(p, result);
+    default:
+        return fail(p, "unexpected character");
+    }
+}
+
+bool json_parse(Tag src, List *owned, Tag *result, JsonError *err) {
+    char buf[SHORT_STR_MAX];
+    const char *c;
+    size_t len;
+    if (!as_str(src, buf, &c, &len)) {
+        assert(0 && "json source is not a string");
+        *err = (JsonError){.msg = "json source is not a string"};
+        return false;
+    }
+    Parser p = {.start = c, .c = c, .end = c + len, .src = src, .owned = owned, .err = err};
+    bool success = parse_value(&p, result);
+    if (success) {
+        skip_space(&p);
+        if (p.c < p.end) {
+            success = fail(&p, "unexpected data after the value");
+        }
+    }
+    list_destroy(&p.stack);
+    if (p.buf) {
+        mem_free_array(p.buf, sizeof(p.buf[0]), p.buf_cap);
+    }
+    return success;
+}
+
+typedef struct Dump {
+    char *c;
+    size_t len;
+    size_t cap;
+    size_t depth;
+    JsonError *err;
+} Dump;
+
+// returns room for len more chars at the end of the output
+static char *grow(Dump *d, size_t len) {
+    if (d->cap - d->len < len) {
+        size_t cap = d->cap ? d->cap : 64;
+        while (cap - d->len < len) {
+            cap *= 2;
+        }
+        d->c = mem_resize_array(d->c, sizeof(d->c[0]), d->cap, cap);
+        d->cap = cap;
+    }
+    return d->c + d->len;
+}
+
+static void put(Dump *d, const char *c, size_t len) {
+    memcpy(grow(d, len), c, len);
+    d->len += len;
+}
+
+static void put_char(Dump *d, char c) {
+    *grow(d, 1) = c;
+    d->len++;
+}
+
+static bool dump_fail(Dump *d, const char *msg, const char *detail) {
+    *d->err = (JsonError){.msg = msg, .detail = detail};
+    return false;
+}
+
+static void dump_str(Dump *d, const char *c, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+    const char *end = c + len;
+    put_char(d, '"');
+    for (const char *special; (special = scan_string(c, end)) < end; c = special + 1) {
+        put(d, c, special - c);
+        char esc[6] = {'\\', *special};
+        size_t esc_len = 2;
+        switch (*special) {
+        case '"':
+        case '\\':
+            break;
+        case '\b':
+            esc[1] = 'b';
+            break;
+        case '\f':
+            esc[1] = 'f';
+            break;
+        case '\n':
+            esc[1] = 'n';
+            break;
+        case '\r':
+            esc[1] = 'r';
+            break;
+        case '\t':
+            esc[1] = 't';
+            break;
+        default:
+            memcpy(esc + 1, "u00", 3);
+            esc[4] = hex[*special >> 4];
+            esc[5] = hex[*special & 0xf];
+            esc_len = 6;
+        }
+        put(d, esc, esc_len);
+    }
+    put(d, c, end - c);
+    put_char(d, '"');
+}
+
+static void dump_int(Dump *d, int64_t i) { d->len += itoa(i, grow(d, ITOA_MAX)); }
+
+static bool dump_value(Dump *d, Tag t);
+
+static bool dump_table(Dump *d, const Table *t) {
+    put_char(d, '{');
+    size_t pos = 0;
+    Tag key, val;
+    for (bool first = true; table_next(t, &pos, &key, &val); first = false) {
+        char buf[SHORT_STR_MAX];
+        const char *c;
+        size_t len;
+        if (!as_str(key, buf, &c, &len)) {
+            return dump_fail(d, "cannot dump a table key of type: ", tag_type_str(tag_type(key)));
+        }
+        if (!first) {
+            put_char(d, ',');
+        }
+        dump_str(d, c, len);
+        put_char(d, ':');
+        if (!dump_value(d, val)) {
+            return false;
+        }
+    }
+    put_char(d, '}');
+    return true;
+}
+
+static bool dump_list(Dump *d, const List *l) {
+    put_char(d, '[');
+    for (size_t i = 0; i < list_len(l); i++) {
+        if (i) {
+            put_char(d, ',');
+        }
+        Tag item = list_load(l, i);
+        bool success = dump_value(d, item);
+        tag_free(item);
+        if (!success) {
+            return false;
+        }
+    }
+    put_char(d, ']');
+    return true;
+}
+
+static void dump_range(Dump *d, const Range *r) {
+    put_char(d, '[');
+    for (size_t i = 0; i < range_len(r); i++) {
+        if (i) {
+            put_char(d, ',');
+        }
+        dump_int(d, range_get(r, i));
+    }
+    put_char(d, ']');
+}
+
+static bool dump_value(Dump *d, Tag t) {
+    char buf[SHORT_STR_MAX];
+    const char *c;
+    size_t len;
+    int64_t i;
+    if (as_str(t, buf, &c, &len)) {
+        dump_str(d, c, len);
+        return true;
+    }
+    if (as_int(t, &i)) {
+        dump_int(d, i);
+        return true;
+    }
+    if (tag_is_double(t)) {
+        if (!isfinite(tag_to_double(t))) {
+            return dump_fail(d, "cannot dump a non-finite number", 0);
+        }
+        d->len += dtoa(tag_to_double(t), grow(d, DTOA_MAX));
+        return true;
+    }
+    if (tag_biteq(t, TAG_NIL) || tag_biteq(t, TAG_TRUE) || tag_biteq(t, TAG_FALSE)) {
+        const char *word = tag_biteq(t, TAG_NIL)    ? "null"
+                           : tag_biteq(t, TAG_TRUE) ? "true"
+                                                    : "false";
+        put(d, word, strlen(word));
+        return true;
+    }
+    if (tag_is_range(t)) {
+        dump_range(d, tag_to_range(t));
+        return true;
+    }
+    if (!tag_is_table(t) && !tag_is_list(t)) {
+        return dump_fail(d, "cannot dump type: ", tag_type_str(tag_type(t)));
+    }
+    // self-referencing containers run into the depth limit too
+    if (++d->depth > JSON_MAX_DEPTH) {
+        return dump_fail(d, "too deeply nested to dump", 0);
+    }
+    bool success =
+        tag_is_table(t) ? dump_table(d, tag_to_table(t)) : dump_list(d, tag_to_list(t));
+    d->depth--;
+    return success;
+}
+
+bool json_dump(Tag t, Tag *result, JsonError *err) {
+    Dump d = {.err = err};
+    bool success = dump_value(&d, t);
+    if (!success || d.len <= SHORT_STR_MAX) {
+        if (success) {
+            *result = short_str_to_tag(d.c, d.len);
+        }
+        if (d.c) {
+            mem_free_array(d.c, sizeof(d.c[0]), d.cap);
+        }
+        return success;
+    }
+    // the spare capacity lets concatenations extend the result in place, see slice_extend()
+    StrBuf *b = mem_allocate(sizeof(*b));
+    *b = (StrBuf){.len = d.len, .cap = d.cap, .c = d.c};
+    *result = slice_to_tag(strbuf_slice(b));
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef slang_json_h
+#define slang_json_h
+
+#include "list.h" // List
+#include "tag.h"  // Tag
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define JSON_MAX_DEPTH 512
+
+typedef struct JsonError {
+    const char *msg;
+    const char *detail; // the type json_dump() can't dump, or 0
+    size_t pos;         // offset of the error in the source, json_parse() only
+} JsonError;
+
+// json_parse() parses the JSON text in the string src into Tables, Lists, strings, ints, doubles,
+// true, false and nil. Objects are presized. Strings without escapes are views into src, see
+// str_view(). The containers hold refs, like the VM's, and every owned value is appended to owned
+// instead, which must outlive the result. The VM passes its temps. The result is a ref or a data
+// tag.
+bool json_parse(Tag src, List *owned, Tag *result, JsonError *);
+
+// json_dump() returns the compact JSON text of t, written into a single growing StrBuf. Only nil,
+// booleans, finite numbers, strings, lists, ranges and tables with string keys can be dumped.
+bool json_dump(Tag t, Tag *result, JsonError *);
+
+#endif
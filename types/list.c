@@ -4,16 +4,82 @@
 #include "mem.h"      // mem_*
 #include "tag.h"      // Tag, tag_*
 
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
 dynarray_define(Tag);
 
+static ListKind packed_kind(Tag t) {
+    if (tag_is_i49(t) || tag_is_i64(t)) {
+        return LIST_INTS;
+    } else if (tag_is_double(t)) {
+        return LIST_DOUBLES;
+    }
+    return LIST_TAGS;
+}
+
+static Tag pack(ListKind kind, Tag t) {
+    int64_t i;
+    if (kind == LIST_INTS && as_int(t, &i)) {
+        return (Tag){.u = (uint64_t)i};
+    }
+    return t;
+}
+
+void list_unpack(List *l, List *owned) {
+    if (l->kind == LIST_INTS) {
+        for (size_t i = 0; i < list_len(l); i++) {
+            Tag *t = list_get(l, i);
+            *t = int_to_tag((int64_t)t->u);
+            if (tag_is_own(*t)) {
+                list_append(owned, *t);
+                *t = tag_to_ref(*t);
+            }
+        }
+    }
+    l->kind = LIST_TAGS;
+}
+
+void list_store(List *l, size_t idx, Tag t, List *owned) {
+    assert(!tag_is_own(t) && "owned value stored in list");
+    if (l->kind != LIST_TAGS && packed_kind(t) != l->kind) {
+        list_unpack(l, owned);
+    }
+    // the old item is a ref, or a packed value
+    *list_get(l, idx) = pack(l->kind, t);
+}
+
+void list_push(List *l, Tag t, List *owned) {
+    assert(!tag_is_own(t) && "owned value pushed to list");
+    if (l->kind == LIST_NEW) {
+        l->kind = packed_kind(t);
+    } else if (l->kind != LIST_TAGS && packed_kind(t) != l->kind) {
+        list_unpack(l, owned);
+    }
+    list_append(l, pack(l->kind, t));
+}
+
 bool list_eq(const List *a, const List *b) {
     if (list_len(a) != list_len(b)) {
         return false;
     }
+    if (a->kind == LIST_INTS && b->kind == LIST_INTS) {
+        for (size_t i = 0; i < list_len(a); i++) {
+            if (list_get(a, i)->u != list_get(b, i)->u) {
+                return false;
+            }
+        }
+        return true;
+    }
     for (size_t i = 0; i < list_len(a); i++) {
-        if (!tag_eq(*list_get(a, i), *list_get(b, i))) {
+        Tag a_item = list_load(a, i);
+        Tag b_item = list_load(b, i);
+        bool eq = tag_eq(a_item, b_item);
+        tag_free(a_item);
+        tag_free(b_item);
+        if (!eq) {
             return false;
         }
     }
@@ -26,8 +92,11 @@ void list_free(List *l) {
 }
 
 void list_destroy(List *l) {
-    for (size_t i = 0; i < list_len(l); i++) {
-        tag_free(*list_get(l, i));
+    // packed items don't own anything
+    if (l->kind == LIST_TAGS) {
+        for (size_t i = 0; i < list_len(l); i++) {
+            tag_free(*list_get(l, i));
+        }
     }
     dynarray_destroy(Tag)(&l->array);
 }
@@ -36,7 +105,9 @@ void list_printf(FILE *f, const List *l) {
     putc('[', f);
     size_t len = list_len(l);
     for (size_t i = 0; i < len; i++) {
-        tag_reprf(f, *list_get(l, i));
+        Tag item = list_load(l, i);
+        tag_reprf(f, item);
+        tag_free(item);
         if (i + 1 < len) {
             fputs(", ", f);
         }
@@ -50,5 +121,7 @@ extern inline Tag list_pop(List *);
 extern inline void list_trunc(List *, size_t);
 extern inline Tag *list_last(const List *);
 extern inline void list_append(List *, Tag);
+extern inline Tag list_load(const List *, size_t);
+extern inline bool list_packs(const List *, Tag);
 extern inline bool list_find_from(const List *, Tag, size_t *);
 extern inline void list_print(const List *);
@@ -11,8 +11,20 @@
 
 dynarray_declare(Tag);
 
+// Lists created for scripts pack their items while they are all ints or all doubles: ints are
+// stored unboxed in the item slots, and doubles are stored as they are since their tags are the
+// doubles themselves. Storing any other value unpacks the list for good. The VM's own lists, like
+// the stack, are never packed.
+typedef enum {
+    LIST_TAGS, // any values
+    LIST_NEW,  // a script list that packs on its first item
+    LIST_INTS,
+    LIST_DOUBLES,
+} ListKind;
+
 typedef struct List {
     DynamicArray(Tag) array;
+    ListKind kind;
 } List;
 
 bool list_eq(const List *, const List *);
@@ -45,6 +57,30 @@ inline Tag *list_last(const List *l) {
 
 inline void list_append(List *l, Tag t) { dynarray_append(Tag)(&l->array, &t); }
 
+// list_load, list_store and list_push handle packed lists. Values passed to them must not be
+// owned, and list_load returns an owned value only when it boxes an int out of the i49 range.
+// Storing a value a packed list can't hold unpacks it: the ints out of the i49 range are boxed
+// again and the boxes are appended to owned, so the list holds refs like any script list. The
+// VM passes its temps, because refs to the boxes can outlive the items.
+
+inline Tag list_load(const List *l, size_t idx) {
+    Tag t = *list_get(l, idx);
+    if (l->kind == LIST_INTS) {
+        return int_to_tag((int64_t)t.u);
+    }
+    // unpacked lists own the ints they had to box
+    return tag_is_own(t) ? tag_to_ref(t) : t;
+}
+
+void list_store(List *, size_t idx, Tag, List *owned);
+void list_push(List *, Tag, List *owned);
+void list_unpack(List *, List *owned);
+
+// Packed lists copy boxed ints, so they don't need the box after a store or a push.
+inline bool list_packs(const List *l, Tag t) {
+    return (l->kind == LIST_INTS || l->kind == LIST_NEW) && tag_is_i64(t);
+}
+
 inline bool list_find_from(const List *l, Tag needle, size_t *idx) {
     for (size_t i = idx ? *idx : 0; i < list_len(l); i++) {
         Tag ith_tag = *list_get(l, i);
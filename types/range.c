@@ -0,0 +1,45 @@
+#include "range.h"
+
+#include "mem.h" // mem_allocate
+
+#include <inttypes.h> // PRId64
+
+Range *range_new(int64_t start, int64_t stop, int64_t step) {
+    assert(step != 0 && "zero range step");
+    Range *r = mem_allocate(sizeof(*r));
+    *r = (Range){.start = start, .stop = stop, .step = step};
+    return r;
+}
+
+bool range_eq(const Range *a, const Range *b) {
+    size_t len = range_len(a);
+    if (len != range_len(b)) {
+        return false;
+    }
+    // the step doesn't matter with less than two items, nor the start with none
+    return len == 0 || (a->start == b->start && (len == 1 || a->step == b->step));
+}
+
+size_t range_hash(const Range *r) {
+    size_t len = range_len(r);
+    uint64_t h = len;
+    if (len > 0) {
+        h = h * UINT64_C(0x9E3779B97F4A7C15) ^ (uint64_t)r->start;
+    }
+    if (len > 1) {
+        h = h * UINT64_C(0x9E3779B97F4A7C15) ^ (uint64_t)r->step;
+    }
+    return h;
+}
+
+void range_printf(FILE *f, const Range *r) {
+    fprintf(f, "range(%" PRId64 ", %" PRId64, r->start, r->stop);
+    if (r->step != 1) {
+        fprintf(f, ", %" PRId64, r->step);
+    }
+    fputc(')', f);
+}
+
+extern inline void range_free(Range *);
+extern inline size_t range_len(const Range *);
+extern inline int64_t range_get(const Range *, size_t);
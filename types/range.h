@@ -0,0 +1,42 @@
+#ifndef slang_range_h
+#define slang_range_h
+
+#include "mem.h" // mem_free
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// A Range is the lazy sequence of ints start, start + step, ... up to, but excluding, stop. Its
+// items are computed on demand, so it takes the same memory whatever its length. The bounds and
+// the length are i49 ints, which keeps every item in the i49 range too, and the step is never
+// zero.
+typedef struct Range {
+    int64_t start;
+    int64_t stop;
+    int64_t step;
+} Range;
+
+Range *range_new(int64_t start, int64_t stop, int64_t step);
+inline void range_free(Range *r) { mem_free(r, sizeof(*r)); }
+
+inline size_t range_len(const Range *r) {
+    int64_t span = r->stop - r->start; // can't overflow, the bounds are i49
+    if (r->step > 0) {
+        return span > 0 ? (size_t)((span - 1) / r->step + 1) : 0;
+    }
+    return span < 0 ? (size_t)((span + 1) / r->step + 1) : 0;
+}
+
+inline int64_t range_get(const Range *r, size_t idx) {
+    assert(idx < range_len(r) && "range index out of bounds");
+    return r->start + (int64_t)idx * r->step;
+}
+
+bool range_eq(const Range *, const Range *); // equal if they have the same items
+size_t range_hash(const Range *);
+void range_printf(FILE *, const Range *);
+
+#endif
@@ -1,5 +1,7 @@
+#define _GNU_SOURCE // memmem
 #include "str.h"
 
+#include "file.h"     // file_unmap
 #include "mem.h"      // mem_*
 #include "safemath.h" // size_t_add_over
 
@@ -8,14 +10,96 @@
 #include <stdint.h>
 #include <string.h>
 
+// str_hash is a port of wyhash (final version 4, public domain). It consumes 48 bytes per step
+// over three independent lanes and reads the tail with overlapping loads, so short keys take a
+// single multiply-mix. Byte order only needs to be consistent within a process.
+
+static const uint64_t wy_secret[] = {
+    UINT64_C(0x2d358dccaa6c78a5),
+    UINT64_C(0x8bb84b93962eacc9),
+    UINT64_C(0x4b33a62ed433d4a3),
+    UINT64_C(0x4d5a2da51de1aa47),
+};
+
+static inline void wy_mum(uint64_t *a, uint64_t *b) {
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t wy_mix(uint64_t a, uint64_t b) {
+    wy_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t wy_r8(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t wy_r4(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t wy_r3(const unsigned char *p, size_t k) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
 size_t str_hash(const char *c, size_t len) {
-    uint64_t res = UINT64_C(2166136261);
-    for (size_t i = 0; i < len; i++) {
-        res ^= c[i];
-        res *= UINT64_C(16777619);
+    const unsigned char *p = (const unsigned char *)c;
+    uint64_t seed = wy_mix(wy_secret[0], wy_secret[1]);
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t off = (len >> 3) << 2;
+            a = (wy_r4(p) << 32) | wy_r4(p + off);
+            b = (wy_r4(p + len - 4) << 32) | wy_r4(p + len - 4 - off);
+        } else if (len > 0) {
+            a = wy_r3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wy_mix(wy_r8(p) ^ wy_secret[1], wy_r8(p + 8) ^ seed);
+                see1 = wy_mix(wy_r8(p + 16) ^ wy_secret[2], wy_r8(p + 24) ^ see1);
+                see2 = wy_mix(wy_r8(p + 32) ^ wy_secret[3], wy_r8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wy_mix(wy_r8(p) ^ wy_secret[1], wy_r8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = wy_r8(p + i - 16);
+        b = wy_r8(p + i - 8);
     }
+    a ^= wy_secret[1];
+    b ^= seed;
+    wy_mum(&a, &b);
+    size_t res = (size_t)wy_mix(a ^ wy_secret[0] ^ len, b ^ wy_secret[1]);
     if (res == 0) { // avoid zero-hashes because 0 indicates no hash is cached
-        res = UINT64_C(0x1337);
+        res = 0x1337;
     }
     return res;
 }
@@ -26,9 +110,11 @@ String *string_append(String *s, const char *c, size_t len) {
         mem_error("string size too large");
         return 0;
     }
+    assert(!s->interned && "interned strings are immutable");
     s = mem_resize_flex(s, sizeof(*s), sizeof(s->c[0]), s->len, new_size);
     memcpy(s->c + s->len, c, len);
     s->len = new_size;
+    s->hash = 0;
     return s;
 }
 
@@ -41,11 +127,85 @@ String *str_concat(const char *l, size_t l_len, const char *r, size_t r_len) {
     String *s = mem_allocate_flex(sizeof(*s), sizeof(s->c[0]), new_size);
     s->len = new_size;
     s->hash = 0;
+    s->interned = false;
     memcpy(s->c, l, l_len);
     memcpy(s->c + l_len, r, r_len);
     return s;
 }
 
+String *string_alloc(size_t len) {
+    String *s = mem_allocate_flex(sizeof(*s), sizeof(s->c[0]), len);
+    s->len = len;
+    s->hash = 0;
+    s->interned = false;
+    return s;
+}
+
+void strbuf_release(StrBuf *b) {
+    assert(b->refs > 0 && "strbuf refs underflow");
+    if (--b->refs) {
+        return;
+    }
+    if (b->mapped) {
+        file_unmap(b->c, b->cap);
+    } else {
+        mem_free_array(b->c, sizeof(b->c[0]), b->cap);
+    }
+    mem_free(b, sizeof(*b));
+}
+
+Slice *strbuf_slice(StrBuf *b) {
+    b->refs++;
+    Slice *s = mem_allocate(sizeof(*s));
+    *s = (Slice){.len = b->len, .c = b->c, .buf = b};
+    return s;
+}
+
+Slice *slice_view(const Slice *s, size_t start, size_t len) {
+    assert(start <= s->len && len <= s->len - start && "view out of bounds");
+    if (s->buf) {
+        s->buf->refs++;
+    }
+    Slice *view = mem_allocate(sizeof(*view));
+    *view = (Slice){.len = len, .c = s->c + start, .buf = s->buf};
+    return view;
+}
+
+Slice *string_view(const String *s, size_t start, size_t len) {
+    assert(start <= s->len && len <= s->len - start && "view out of bounds");
+    Slice *view = mem_allocate(sizeof(*view));
+    *view = (Slice){.len = len, .c = s->c + start};
+    return view;
+}
+
+Slice *str_build(const char *l, size_t l_len, const char *r, size_t r_len) {
+    size_t len, cap;
+    if (size_t_add_over(l_len, r_len, &len) || size_t_mul_over(len, 2, &cap)) {
+        mem_error("string size too large");
+        return 0;
+    }
+    StrBuf *b = mem_allocate(sizeof(*b));
+    *b = (StrBuf){.len = len, .cap = cap};
+    b->c = mem_resize_array(0, sizeof(b->c[0]), 0, cap);
+    memcpy(b->c, l, l_len);
+    memcpy(b->c + l_len, r, r_len);
+    return strbuf_slice(b);
+}
+
+Slice *slice_extend(const Slice *s, const char *c, size_t len) {
+    StrBuf *b = s->buf;
+    if (!b || b->mapped || s->c + s->len != b->c + b->len || b->cap - b->len < len) {
+        return 0; // not at the buffer's tail or no room left
+    }
+    memcpy(b->c + b->len, c, len); // c can point inside b but never past len
+    b->len += len;
+    // s can be a view that starts after the buffer's first char
+    b->refs++;
+    Slice *extended = mem_allocate(sizeof(*extended));
+    *extended = (Slice){.len = s->len + len, .c = s->c, .buf = b};
+    return extended;
+}
+
 int str_cmp(const char *l, size_t l_len, const char *r, size_t r_len) {
     size_t min_len = l_len;
     if (r_len < min_len) {
@@ -64,6 +224,120 @@ int str_cmp(const char *l, size_t l_len, const char *r, size_t r_len) {
     return 0;
 }
 
+const char *str_find(const char *h, size_t h_len, const char *n, size_t n_len) {
+    if (n_len == 0) {
+        return h;
+    }
+    if (n_len > h_len) {
+        return 0;
+    }
+    if (n_len == 1) {
+        return memchr(h, n[0], h_len);
+    }
+#ifdef __GLIBC__
+    return memmem(h, h_len, n, n_len); // two-way search with vectorized scanning
+#else
+    // memchr skips to the candidates, which is fast unless the first char is common
+    const char *last = h + (h_len - n_len);
+    for (const char *c = h; c <= last; c++) {
+        c = memchr(c, n[0], (size_t)(last - c) + 1);
+        if (!c) {
+            return 0;
+        }
+        if (memcmp(c + 1, n + 1, n_len - 1) == 0) {
+            return c;
+        }
+    }
+    return 0;
+#endif
+}
+
+// The intern table is an open addressing hash set with linear probing. It only grows, and is
+// destroyed all at once by str_intern_destroy().
+static struct {
+    String **strings;
+    size_t len;
+    size_t cap;
+} intern_table = {0};
+
+static String **intern_find(const char *c, size_t len, size_t hash) {
+    assert((intern_table.cap & (intern_table.cap - 1)) == 0 && "cap not a power of two");
+    size_t mask = intern_table.cap - 1;
+    for (size_t idx = hash & mask;; idx = (idx + 1) & mask) {
+        String **slot = &intern_table.strings[idx];
+        String *s = *slot;
+        if (!s || (s->hash == hash && s->len == len && memcmp(s->c, c, len) == 0)) {
+            return slot;
+        }
+    }
+}
+
+static void intern_grow(void) {
+    String **old = intern_table.strings;
+    size_t old_cap = intern_table.cap;
+    size_t new_cap = old_cap ? old_cap * 2 : 64;
+    intern_table.strings = mem_resize_array(0, sizeof(String *), 0, new_cap);
+    intern_table.cap = new_cap;
+    for (size_t i = 0; i < new_cap; i++) {
+        intern_table.strings[i] = 0;
+    }
+    for (size_t i = 0; i < old_cap; i++) {
+        String *s = old[i];
+        if (s) {
+            *intern_find(s->c, s->len, s->hash) = s;
+        }
+    }
+    mem_free_array(old, sizeof(String *), old_cap);
+}
+
+// intern_slot() returns the slot where a String with this content is, or should be, stored
+static String **intern_slot(const char *c, size_t len, size_t hash) {
+    if ((intern_table.len + 1) * 4 > intern_table.cap * 3) {
+        intern_grow();
+    }
+    return intern_find(c, len, hash);
+}
+
+String *str_intern(const char *c, size_t len) {
+    size_t hash = str_hash(c, len);
+    String **slot = intern_slot(c, len, hash);
+    if (!*slot) {
+        String *s = string_new(c, len);
+        s->hash = hash;
+        s->interned = true;
+        *slot = s;
+        intern_table.len++;
+    }
+    return *slot;
+}
+
+String *string_intern(String *s) {
+    if (s->interned) {
+        return s;
+    }
+    String **slot = intern_slot(s->c, s->len, string_hash(s));
+    if (*slot) {
+        string_free(s);
+        return *slot;
+    }
+    s->interned = true;
+    *slot = s;
+    intern_table.len++;
+    return s;
+}
+
+void str_intern_destroy(void) {
+    for (size_t i = 0; i < intern_table.cap; i++) {
+        if (intern_table.strings[i]) {
+            string_free(intern_table.strings[i]);
+        }
+    }
+    mem_free_array(intern_table.strings, sizeof(String *), intern_table.cap);
+    intern_table.strings = 0;
+    intern_table.len = 0;
+    intern_table.cap = 0;
+}
+
 extern inline String *string_new(const char *, size_t);
 extern void string_free(String *);
 extern inline Slice slice(const char *, const char *);
@@ -12,13 +12,26 @@
 typedef struct String {
     size_t len;
     size_t hash;
+    bool interned; // interned Strings are equal only if they're the same String
     char c[];
 } String;
 
+// A StrBuf is a reference counted, append-only char buffer shared by Slices. The chars before len
+// never change, so the Slice ending at len can be extended by appending to the buffer and creating
+// a longer Slice over the same chars. This makes repeated concatenation amortized O(1).
+typedef struct StrBuf {
+    size_t refs;
+    size_t len;
+    size_t cap;
+    char *c;
+    bool mapped; // c is a read-only file mapping of cap chars, see file_map()
+} StrBuf;
+
 typedef struct Slice {
     size_t len;
     size_t hash;
     const char *c;
+    StrBuf *buf; // optional, holds a reference to the StrBuf where c points to
 } Slice; // Slices don't own char *c
 
 #define SLICE(s)                                                                                   \
@@ -28,6 +41,7 @@ inline String *string_new(const char *c, size_t len) {
     String *s = mem_allocate_flex(sizeof(*s), sizeof(s->c[0]), len);
     s->len = len;
     s->hash = 0;
+    s->interned = false;
     memcpy(s->c, c, len);
     return s;
 }
@@ -38,7 +52,20 @@ inline Slice slice(const char *start, const char *end) {
     assert(start <= end);
     return (Slice){.len = end - start, .c = start};
 }
-inline void slice_free(Slice *s) { mem_free(s, sizeof(*s)); }
+void strbuf_release(StrBuf *);
+Slice *strbuf_slice(StrBuf *); // a Slice over the chars before len, holding a reference to the buf
+// slice_view() returns a Slice of len chars of s from start that shares s's StrBuf. If s has no
+// StrBuf, its chars must outlive the view.
+Slice *slice_view(const Slice *s, size_t start, size_t len);
+// string_view() returns a Slice of len chars of s from start. Strings aren't reference counted, so
+// s must outlive the view. The VM only frees the Strings a script can reach when it exits.
+Slice *string_view(const String *s, size_t start, size_t len);
+inline void slice_free(Slice *s) {
+    if (s->buf) {
+        strbuf_release(s->buf);
+    }
+    mem_free(s, sizeof(*s));
+}
 
 // TODO: get rid of the int cast
 #define STR_PRINTF fprintf(f, "%.*s", (int)s->len, s->c)
@@ -82,14 +109,33 @@ inline size_t slice_hash(Slice *s) { STR_HASH; }
         return false;                                                                              \
     }                                                                                              \
     return memcmp(a->c, b->c, a->len) == 0
-inline bool string_eq_string(const String *a, const String *b) { STR_EQ_STR; }
+inline bool string_eq_string(const String *a, const String *b) {
+    if (a->interned && b->interned) {
+        return a == b;
+    }
+    STR_EQ_STR;
+}
 inline bool string_eq_slice(const String *a, const Slice *b) { STR_EQ_STR; }
 inline bool slice_eq_slice(const Slice *a, const Slice *b) { STR_EQ_STR; }
 inline bool slice_eq_string(const Slice *a, const String *b) { return string_eq_slice(b, a); }
 #undef STR_EQ_STR
 
 int str_cmp(const char *, size_t, const char *, size_t);
+// str_find() returns the first occurrence of needle in haystack, or 0
+const char *str_find(const char *haystack, size_t, const char *needle, size_t);
 String *string_append(String *, const char *, size_t);
 String *str_concat(const char *, size_t, const char *, size_t);
+String *string_alloc(size_t len); // the chars are left uninitialized
+
+// Concatenations at least STR_BUILD_MIN long are built in StrBufs.
+#define STR_BUILD_MIN 32
+Slice *str_build(const char *, size_t, const char *, size_t);
+Slice *slice_extend(const Slice *, const char *, size_t); // returns 0 if s can't be extended
+
+// The intern table keeps a single String for each distinct content. Interned Strings are owned by
+// the intern table, have their hash computed once, and compare equal only to themselves.
+String *str_intern(const char *, size_t);
+String *string_intern(String *); // takes ownership of the String
+void str_intern_destroy(void);
 
 #endif
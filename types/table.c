@@ -1,31 +1,166 @@
 #include "table.h"
 
 #include "dynarray.h" // dynarray_*
+#include "list.h"     // DynamicArray(Tag)
 #include "mem.h"      // mem_*
-#include "tag.h"      // Tag, tag_*, USER_SYMBOL
+#include "safemath.h" // size_t_mul_over
+#include "tag.h"      // Tag, tag_*
 
+#include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 dynarray_define(Entry);
 
-#define TOMBSTONE_KEY USER_SYMBOL(0)
-#define EMPTY_KEY USER_SYMBOL(1)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TABLE_SSE2
+#include <emmintrin.h>
+#endif
+
+#define GROUP 16
+#define MIN_CAP GROUP
+
+// Tables with up to SMALL_MAX entries have no index and are searched linearly.
+#define SMALL_MAX 8
+
+// Deleted entries are overwritten with a key that can't come from user code.
+#define HOLE_KEY USER_SYMBOL(0)
+
+// Control bytes: full slots hold the top 7 bits of the key hash and have the high bit clear.
+#define CTRL_EMPTY ((uint8_t)0x80)
+#define CTRL_DELETED ((uint8_t)0xfe)
+
+static uint8_t hash_fragment(size_t hash) {
+    return (hash >> (sizeof(hash) * CHAR_BIT - 7)) & 0x7f;
+}
+
+// Bit i of a Mask is set when slot i of a group matches.
+typedef uint32_t Mask;
+
+#ifdef TABLE_SSE2
+
+static Mask group_match(const uint8_t *group, uint8_t c) {
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (Mask)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)c)));
+}
+
+static Mask group_match_unset(const uint8_t *group) {
+    // empty and deleted are the only control bytes with the high bit set
+    return (Mask)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+}
+
+#else
+
+static Mask group_match(const uint8_t *group, uint8_t c) {
+    Mask m = 0;
+    for (int i = 0; i < GROUP; i++) {
+        m |= (Mask)(group[i] == c) << i;
+    }
+    return m;
+}
+
+static Mask group_match_unset(const uint8_t *group) {
+    Mask m = 0;
+    for (int i = 0; i < GROUP; i++) {
+        m |= (Mask)(group[i] >> 7) << i;
+    }
+    return m;
+}
+
+#endif
+
+static unsigned mask_first(Mask m) {
+    assert(m && "empty mask");
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(m);
+#else
+    unsigned i = 0;
+    while (!(m & 1)) {
+        m >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+// At most 7/8 of the index slots are full or deleted, so lookups always find an empty slot.
+static size_t usable(size_t cap) { return cap - cap / 8; }
+
+static size_t index_width(size_t cap) {
+    if (cap <= (size_t)1 << 8) {
+        return 1;
+    } else if (cap <= (size_t)1 << 16) {
+        return 2;
+    } else if (cap <= (size_t)UINT32_MAX + 1) {
+        return 4;
+    }
+    return 8;
+}
+
+static size_t index_get(const Table *t, size_t slot) {
+    // the index starts after cap control bytes, and cap is a multiple of 16, so it's aligned
+    const void *index = t->ctrl + t->cap;
+    switch (index_width(t->cap)) {
+    case 1:
+        return ((const uint8_t *)index)[slot];
+    case 2:
+        return ((const uint16_t *)index)[slot];
+    case 4:
+        return ((const uint32_t *)index)[slot];
+    default:
+        return ((const uint64_t *)index)[slot];
+    }
+}
+
+static void index_set(Table *t, size_t slot, size_t pos) {
+    void *index = t->ctrl + t->cap;
+    switch (index_width(t->cap)) {
+    case 1:
+        ((uint8_t *)index)[slot] = pos;
+        break;
+    case 2:
+        ((uint16_t *)index)[slot] = pos;
+        break;
+    case 4:
+        ((uint32_t *)index)[slot] = pos;
+        break;
+    default:
+        ((uint64_t *)index)[slot] = pos;
+    }
+}
+
+static bool is_hole(const Entry *entry) { return tag_biteq(entry->key, HOLE_KEY); }
+
+size_t table_bytes(const Table *t) {
+    return t->cap * (sizeof(t->ctrl[0]) + index_width(t->cap)) +
+           dynarray_cap(Entry)(&t->entries) * sizeof(Entry) +
+           dynarray_cap(Tag)(&t->array) * sizeof(Tag);
+}
 
 #ifdef SLANG_DEBUG
 
 static TableStats stats = {0};
 
 TableStats table_stats(void) { return stats; }
+void table_stats_reset(void) { stats = (TableStats){0}; }
+
+static void stats_query(uint64_t groups) {
+    stats.queries++;
+    stats.probes += groups;
+    if (groups > stats.max_probe) {
+        stats.max_probe = groups;
+    }
+}
 
 void table_print_summary(const Table *t) {
-    size_t cap = dynarray_cap(Entry)(&t->array);
-    for (size_t i = 0; i < cap; i++) {
-        Entry *entry = dynarray_get(Entry)(&t->array, i);
-        if (tag_biteq(entry->key, TOMBSTONE_KEY)) {
+    for (size_t i = 0; i < t->cap; i++) {
+        uint8_t c = t->ctrl[i];
+        if (c == CTRL_DELETED) {
             putchar('.');
-        } else if (tag_biteq(entry->key, EMPTY_KEY)) {
+        } else if (c == CTRL_EMPTY) {
             putchar(' ');
         } else {
             putchar('#');
@@ -48,151 +183,611 @@ static bool key_eq(Tag a, Tag b) {
     }
 }
 
-static bool is_unset(Tag t) { return tag_biteq(t, EMPTY_KEY) || tag_biteq(t, TOMBSTONE_KEY); }
+// Groups are probed in triangular steps, which visits every group of a power-of-two index.
+// Lookups stop at the first group with an empty slot, so keys never live past such a group.
 
-static Entry *find_entry(const Table *t, Tag key) {
+static size_t find_slot(const Table *t, Tag key, size_t hash) {
+    assert((t->cap & (t->cap - 1)) == 0 && t->cap >= MIN_CAP && "cap not a power of two");
+    size_t mask = t->cap / GROUP - 1;
+    uint8_t fragment = hash_fragment(hash);
+    size_t g = hash & mask;
+    for (size_t step = 1;; step++) {
+        const uint8_t *group = &t->ctrl[g * GROUP];
+        for (Mask m = group_match(group, fragment); m; m &= m - 1) {
+            size_t slot = g * GROUP + mask_first(m);
+            Entry *entry = dynarray_get(Entry)(&t->entries, index_get(t, slot));
+            if (entry->hash == hash && key_eq(entry->key, key)) {
 #ifdef SLANG_DEBUG
-    stats.queries++;
+                stats_query(step);
 #endif
-    size_t hash = tag_hash(key);
-    size_t cap = dynarray_cap(Entry)(&t->array);
-    assert((cap & (cap - 1)) == 0 && "cap not a power of two");
-    size_t mask = cap - 1;
-    size_t idx = hash & mask;
-    Entry *first_tombstone = 0;
-    for (;;) {
-        Entry *entry = dynarray_get(Entry)(&t->array, idx);
-        if (tag_biteq(entry->key, EMPTY_KEY)) {
-            return first_tombstone ? first_tombstone : entry;
-        } else if (tag_biteq(entry->key, TOMBSTONE_KEY)) {
-            first_tombstone = first_tombstone ? first_tombstone : entry;
-        } else {
-            if (key_eq(entry->key, key)) {
-                return entry;
+                return slot;
+            }
 #ifdef SLANG_DEBUG
-            } else {
-                stats.collisions++;
+            stats.collisions++;
 #endif
-            }
         }
-        idx = (idx + 1) & mask;
+        if (group_match(group, CTRL_EMPTY)) {
+#ifdef SLANG_DEBUG
+            stats_query(step);
+#endif
+            return t->cap;
+        }
+        g = (g + step) & mask;
+    }
+}
+
+static size_t find_unset_slot(const Table *t, size_t hash) {
+    assert((t->cap & (t->cap - 1)) == 0 && t->cap >= MIN_CAP && "cap not a power of two");
+    size_t mask = t->cap / GROUP - 1;
+    size_t g = hash & mask;
+    for (size_t step = 1;; step++) {
+        Mask m = group_match_unset(&t->ctrl[g * GROUP]);
+        if (m) {
+#ifdef SLANG_DEBUG
+            stats_query(step);
+#endif
+            return g * GROUP + mask_first(m);
+        }
+        g = (g + step) & mask;
+    }
+}
+
+static void free_index(Table *t) {
+    mem_free_array(t->ctrl, sizeof(t->ctrl[0]) + index_width(t->cap), t->cap);
+    t->ctrl = 0;
+    t->cap = 0;
+    t->deleted = 0;
+}
+
+// Rebuilds the index with cap slots and moves the live entries, in order, into an entries array
+// sized exactly to what the new index can hold.
+static void resize(Table *t, size_t cap) {
+    Table n = {0};
+    n.cap = cap;
+    n.ctrl = mem_resize_array(0, sizeof(n.ctrl[0]) + index_width(cap), 0, cap);
+    memset(n.ctrl, CTRL_EMPTY, cap);
+    dynarray_resize(Entry)(&n.entries, usable(cap));
+    size_t len = dynarray_len(Entry)(&t->entries);
+    for (size_t i = 0; i < len; i++) {
+        Entry *entry = dynarray_get(Entry)(&t->entries, i);
+        if (is_hole(entry)) {
+            continue;
+        }
+        size_t slot = find_unset_slot(&n, entry->hash);
+        n.ctrl[slot] = hash_fragment(entry->hash);
+        index_set(&n, slot, dynarray_len(Entry)(&n.entries));
+        dynarray_append(Entry)(&n.entries, entry);
     }
+    n.real_len = t->real_len;
+    n.array = t->array;
+    dynarray_destroy(Entry)(&t->entries);
+    free_index(t);
+    *t = n;
 }
 
-static void grow(Table *t) {
-    size_t old_cap = dynarray_cap(Entry)(&t->array);
-    dynarray_grow(Entry)(&t->array);
-    size_t new_cap = dynarray_cap(Entry)(&t->array);
-    for (size_t i = old_cap; i < new_cap; i++) {
-        dynarray_get(Entry)(&t->array, i)->key = EMPTY_KEY;
+// Frozen entries keep their insertion order and are found through a minimal perfect hash built
+// by hash and displace: keys are grouped into len buckets by their hash, and each bucket holds
+// either a displacement that sends all its keys to distinct free slots, or, for buckets with a
+// single key, the slot itself. A lookup hashes the key once and compares a single entry.
+struct Frozen {
+    size_t refs; // tables sharing the entries
+    size_t len;
+    int64_t *disp; // per bucket, a displacement or -1 - slot
+    size_t *slots; // entry position of each slot
+    Entry entries[];
+};
+
+// Keys that can't be separated, like different keys with the same hash, stop the search.
+#define FREEZE_TRIES 100000
+
+static size_t displace(size_t hash, uint64_t d, size_t len) {
+    uint64_t x = (uint64_t)hash ^ (d * 0x9e3779b97f4a7c15u);
+    x ^= x >> 32;
+    x *= 0xd6e8feb86659fd93u;
+    x ^= x >> 32;
+    return x % len;
+}
+
+static Tag *frozen_find(Frozen *f, Tag key) {
+    size_t hash = tag_hash(key);
+    int64_t d = f->disp[hash % f->len];
+    size_t slot = d < 0 ? (size_t)(-1 - d) : displace(hash, d, f->len);
+    Entry *entry = &f->entries[f->slots[slot]];
+    if (entry->hash != hash || !key_eq(entry->key, key)) {
+        return 0;
     }
+    return &entry->val;
+}
 
-    // Inline rehashing: find the 1st unset and and start rehashing entries to its
-    // right which should either move between the 1st unset and their position or
-    // to the new zone. Continue rehashing entries to the right. Then, rehash the
-    // items before the 1st unset.
-    size_t start = 0;
-    // find the start position
-    for (start = 0; start < old_cap; start++) {
-        if (tag_biteq(dynarray_get(Entry)(&t->array, start)->key, EMPTY_KEY)) {
-            break;
+static void frozen_release(Frozen *f) {
+    if (--f->refs) {
+        return;
+    }
+    // the entries only hold constants, there's nothing to free
+    mem_free_array(f->disp, sizeof(f->disp[0]), f->len);
+    mem_free_array(f->slots, sizeof(f->slots[0]), f->len);
+    mem_free_flex(f, sizeof(*f), sizeof(f->entries[0]), f->len);
+}
+
+// Places the buckets with more than one key first, largest first, then gives the free slots to
+// the buckets with a single key.
+static bool frozen_build(Frozen *f) {
+    size_t len = f->len;
+    size_t *heads = mem_resize_array(0, sizeof(heads[0]), 0, len);
+    size_t *next = mem_resize_array(0, sizeof(next[0]), 0, len); // chains a bucket's entries
+    size_t *sizes = mem_resize_array(0, sizeof(sizes[0]), 0, len);
+    memset(heads, 0xff, len * sizeof(heads[0]));
+    memset(sizes, 0, len * sizeof(sizes[0]));
+    memset(f->slots, 0xff, len * sizeof(f->slots[0]));
+    memset(f->disp, 0, len * sizeof(f->disp[0]));
+    size_t max_size = 0;
+    for (size_t i = 0; i < len; i++) {
+        size_t b = f->entries[i].hash % len;
+        next[i] = heads[b];
+        heads[b] = i;
+        if (++sizes[b] > max_size) {
+            max_size = sizes[b];
         }
     }
-    assert((start < old_cap || old_cap == 0) && "table can't be full");
-    // rehash
-    size_t remaining = t->real_len;
-    assert((old_cap & (old_cap - 1)) == 0 && "cap not a power of two");
-    size_t mask = old_cap - 1;
-    for (size_t i = (start + 1) & mask; remaining; i = (i + 1) & mask) {
-        Entry *entry = dynarray_get(Entry)(&t->array, i);
-        if (tag_biteq(entry->key, EMPTY_KEY)) {
+    bool result = true;
+    for (size_t size = max_size; size > 1 && result; size--) {
+        for (size_t b = 0; b < len && result; b++) {
+            if (sizes[b] != size) {
+                continue;
+            }
+            for (uint64_t d = 0;; d++) {
+                if (d == FREEZE_TRIES) {
+                    result = false;
+                    break;
+                }
+                size_t i = heads[b];
+                for (; i != SIZE_MAX; i = next[i]) {
+                    size_t slot = displace(f->entries[i].hash, d, len);
+                    if (f->slots[slot] != SIZE_MAX) {
+                        break;
+                    }
+                    f->slots[slot] = i;
+                }
+                if (i == SIZE_MAX) {
+                    f->disp[b] = d;
+                    break;
+                }
+                // undo the keys placed before the collision
+                for (size_t j = heads[b]; j != i; j = next[j]) {
+                    f->slots[displace(f->entries[j].hash, d, len)] = SIZE_MAX;
+                }
+            }
+        }
+    }
+    for (size_t b = 0, slot = 0; b < len && result; b++) {
+        if (sizes[b] != 1) {
             continue;
         }
-        if (tag_biteq(entry->key, TOMBSTONE_KEY)) {
-            entry->key = EMPTY_KEY;
-            dynarray_trunc(Entry)(&t->array, dynarray_len(Entry)(&t->array) - 1);
+        while (f->slots[slot] != SIZE_MAX) {
+            slot++;
+        }
+        f->slots[slot] = heads[b];
+        f->disp[b] = -1 - (int64_t)slot;
+    }
+    mem_free_array(heads, sizeof(heads[0]), len);
+    mem_free_array(next, sizeof(next[0]), len);
+    mem_free_array(sizes, sizeof(sizes[0]), len);
+    return result;
+}
+
+bool table_freeze(Table *t) {
+    assert(!t->frozen && "table already frozen");
+    size_t len = table_len(t);
+    if (len == 0) {
+        return false;
+    }
+    Frozen *f = mem_allocate_flex(sizeof(*f), sizeof(f->entries[0]), len);
+    f->refs = 1;
+    f->len = len;
+    f->disp = mem_resize_array(0, sizeof(f->disp[0]), 0, len);
+    f->slots = mem_resize_array(0, sizeof(f->slots[0]), 0, len);
+    size_t pos = 0;
+    for (size_t i = 0; i < dynarray_len(Tag)(&t->array); i++) {
+        Tag key = i49_to_tag(i);
+        Tag val = *dynarray_get(Tag)(&t->array, i);
+        f->entries[pos++] = (Entry){.key = key, .val = val, .hash = tag_hash(key)};
+    }
+    for (size_t i = 0; pos < len; i++) {
+        Entry *entry = dynarray_get(Entry)(&t->entries, i);
+        if (is_hole(entry)) {
             continue;
         }
-        remaining--;
-        Entry copy = *entry;
-        entry->key = EMPTY_KEY;
-        *find_entry(t, copy.key) = copy;
+        f->entries[pos] = *entry;
+        f->entries[pos++].hash = tag_hash(entry->key); // small tables don't cache hashes
+    }
+    for (size_t i = 0; i < len; i++) {
+        assert(!tag_is_own(f->entries[i].key) && !tag_is_own(f->entries[i].val) &&
+               "frozen tables only hold constants");
     }
+    if (!frozen_build(f)) {
+        frozen_release(f);
+        return false;
+    }
+    dynarray_destroy(Tag)(&t->array);
+    dynarray_destroy(Entry)(&t->entries);
+    free_index(t);
+    t->real_len = len;
+    t->frozen = f;
+    return true;
+}
+
+void table_share(Table *t, const Table *frozen) {
+    assert(frozen->frozen && "table isn't frozen");
+    *t = (Table){.real_len = frozen->real_len, .frozen = frozen->frozen};
+    t->frozen->refs++;
+}
+
+// Copies the shared entries into the table before its first write.
+static void thaw(Table *t) {
+    Frozen *f = t->frozen;
+    *t = (Table){0};
+    // tables keyed 0, 1, ... go into the array part and don't need an index
+    if (!tag_is_i49(f->entries[0].key)) {
+        table_reserve(t, f->len);
+    }
+    for (size_t i = 0; i < f->len; i++) {
+        table_set(t, f->entries[i].key, f->entries[i].val);
+    }
+    frozen_release(f);
+}
+
+// Frozen tables keep their entries apart, in the same order and without holes.
+static const Entry *entry_at(const Table *t, size_t pos) {
+    return t->frozen ? &t->frozen->entries[pos] : dynarray_get(Entry)(&t->entries, pos);
+}
+
+// The array part holds the values of keys 0..n-1 while the hash part is empty. It only grows by
+// appending the next i49 key, so its order is also the insertion order.
+
+static bool array_index(Tag key, size_t *idx) {
+    if (tag_is_i49(key)) {
+        int64_t i = tag_to_i49(key);
+        if (i < 0) {
+            return false;
+        }
+        *idx = i;
+        return true;
+    }
+    if (tag_is_double(key)) {
+        // integral doubles are equal to ints
+        double d = tag_to_double(key);
+        if (d >= 0 && d <= I49_MAX && d == (int64_t)d) {
+            *idx = d;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool hash_set(Table *t, Tag key, Tag val);
+
+// Moves the array part into the hash part. It's needed before the table gets a key that
+// doesn't extend the array part or loses a key from its middle.
+static void array_to_hash(Table *t) {
+    DynamicArray(Tag) array = t->array;
+    t->array = (DynamicArray(Tag)){0};
+    size_t len = dynarray_len(Tag)(&array);
+    size_t cap = MIN_CAP;
+    while (usable(cap) <= len) {
+        cap *= 2;
+    }
+    if (len > SMALL_MAX) {
+        resize(t, cap);
+    }
+    for (size_t i = 0; i < len; i++) {
+        hash_set(t, i49_to_tag(i), *dynarray_get(Tag)(&array, i));
+    }
+    dynarray_destroy(Tag)(&array);
+}
+
+void table_reserve(Table *t, size_t len) {
+    if (t->cap || table_len(t) || len <= SMALL_MAX) {
+        return;
+    }
+    size_t cap = MIN_CAP;
+    while (usable(cap) < len) {
+        cap *= 2;
+    }
+    resize(t, cap);
 }
 
 bool table_set(Table *t, Tag key, Tag val) {
-    assert(!is_unset(key) && "table keys cannot be user symbols 0 or 1");
-    size_t len = dynarray_len(Entry)(&t->array);
-    size_t cap = dynarray_cap(Entry)(&t->array);
-    assert((len == 0 || len < cap) && "table invariant");
+    if (t->frozen) {
+        thaw(t);
+    }
+    if (t->real_len == 0) {
+        size_t len = dynarray_len(Tag)(&t->array);
+        size_t idx;
+        if (array_index(key, &idx) && idx < len) {
+            Tag *slot = dynarray_get(Tag)(&t->array, idx);
+            tag_free(*slot);
+            tag_free(key);
+            *slot = val;
+            return false;
+        } else if (array_index(key, &idx) && idx == len && tag_is_i49(key)) {
+            dynarray_append(Tag)(&t->array, &val);
+            return true;
+        } else if (len) {
+            array_to_hash(t);
+        }
+    }
+    return hash_set(t, key, val);
+}
+
+// In small mode the entries have no index and no cached hashes, and there are no holes. Keys are
+// first matched by their bits, ignoring the ownership flag of pointers, which finds ints,
+// symbols, short strings and interned strings without calling key_eq.
+
+static size_t small_find(const Table *t, Tag key) {
+    size_t len = dynarray_len(Entry)(&t->entries);
+    assert(len <= SMALL_MAX && "small table too large");
+    uint64_t mask = tag_is_ptr(key) ? ~(uint64_t)1 : ~(uint64_t)0;
+    unsigned m = 0;
+    for (size_t i = 0; i < len; i++) {
+        m |= (unsigned)(((dynarray_get(Entry)(&t->entries, i)->key.u ^ key.u) & mask) == 0) << i;
+    }
+    if (m) {
+        return mask_first(m);
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (key_eq(dynarray_get(Entry)(&t->entries, i)->key, key)) {
+            return i;
+        }
+    }
+    return len;
+}
+
+static void small_to_hash(Table *t) {
+    for (size_t i = 0; i < dynarray_len(Entry)(&t->entries); i++) {
+        Entry *entry = dynarray_get(Entry)(&t->entries, i);
+        entry->hash = tag_hash(entry->key);
+    }
+    resize(t, MIN_CAP);
+}
+
+static void hash_to_small(Table *t) {
+    size_t len = dynarray_len(Entry)(&t->entries);
+    size_t small_len = 0;
+    for (size_t i = 0; i < len; i++) {
+        Entry *entry = dynarray_get(Entry)(&t->entries, i);
+        if (!is_hole(entry)) {
+            *dynarray_get(Entry)(&t->entries, small_len++) = *entry;
+        }
+    }
+    dynarray_trunc(Entry)(&t->entries, small_len);
+    dynarray_resize(Entry)(&t->entries, SMALL_MAX);
+    free_index(t);
+}
+
+static bool hash_set(Table *t, Tag key, Tag val) {
+    if (t->cap == 0) {
+        size_t pos = small_find(t, key);
+        if (pos < t->real_len) {
+            Entry *entry = dynarray_get(Entry)(&t->entries, pos);
+            tag_free(entry->val);
+            tag_free(key);
+            entry->val = val;
+            return false;
+        }
+        if (t->real_len < SMALL_MAX) {
+            dynarray_append(Entry)(&t->entries, &(Entry){.key = key, .val = val});
+            t->real_len++;
+            return true;
+        }
+        small_to_hash(t);
+    }
+    size_t hash = tag_hash(key);
+    if (t->real_len) {
+        size_t slot = find_slot(t, key, hash);
+        if (slot < t->cap) {
+            Entry *entry = dynarray_get(Entry)(&t->entries, index_get(t, slot));
+            tag_free(entry->val);
+            tag_free(key);
+            entry->val = val;
+            return false;
+        }
+    }
+    size_t len = dynarray_len(Entry)(&t->entries);
     assert(len >= t->real_len && "table invariant");
-    if (len + 1 > (cap / 7) * 5) {
-        grow(t);
-        len = dynarray_len(Entry)(&t->array); // len changes when tombstones clear
-    }
-    Entry *entry = find_entry(t, key);
-    bool new = false;
-    if (tag_biteq(entry->key, TOMBSTONE_KEY)) {
-        entry->key = key;
-        t->real_len++;
-        new = true;
-    } else if (tag_biteq(entry->key, EMPTY_KEY)) {
-        entry->key = key;
-        dynarray_trunc(Entry)(&t->array, len + 1);
-        t->real_len++;
-        new = true;
-    } else {
-        tag_free(entry->val);
-        tag_free(key);
+    if (len == usable(t->cap) || t->real_len + t->deleted == usable(t->cap)) {
+        // Either the entries or the empty slots ran out. Holes at the end of the entries are
+        // dropped by deletes, so their deleted slots are counted apart. Double when live
+        // entries fill half the index, otherwise rebuild it at the same size to drop the holes
+        // and the deleted slots.
+        size_t new_cap = t->cap;
+        if (t->real_len + 1 > t->cap / 2 && size_t_mul_over(t->cap, 2, &new_cap)) {
+            mem_error("table size too large");
+            return false;
+        }
+        resize(t, new_cap);
+        len = dynarray_len(Entry)(&t->entries);
     }
-    entry->val = val;
-    return new;
+    size_t slot = find_unset_slot(t, hash);
+    t->deleted -= t->ctrl[slot] == CTRL_DELETED;
+    t->ctrl[slot] = hash_fragment(hash);
+    index_set(t, slot, len);
+    dynarray_append(Entry)(&t->entries, &(Entry){.key = key, .val = val, .hash = hash});
+    t->real_len++;
+    return true;
 }
 
-bool table_get(const Table *t, Tag key, Tag *val) {
-    assert(!is_unset(key) && "table keys cannot be user symbols 0 or 1");
+// Returns a pointer to the value of key, or 0 if the key isn't in the table.
+static Tag *find_val(const Table *t, Tag key) {
+    size_t len = dynarray_len(Tag)(&t->array);
+    if (len) {
+        size_t idx;
+        if (!array_index(key, &idx) || idx >= len) {
+            return 0;
+        }
+        return dynarray_get(Tag)(&t->array, idx);
+    }
     if (t->real_len == 0) {
-        return false;
+        return 0;
+    }
+    if (t->cap == 0) {
+        if (t->frozen) {
+            return frozen_find(t->frozen, key);
+        }
+        size_t pos = small_find(t, key);
+        if (pos == t->real_len) {
+            return 0;
+        }
+        return &dynarray_get(Entry)(&t->entries, pos)->val;
     }
-    Entry *entry = find_entry(t, key);
-    if (is_unset(entry->key)) {
+    size_t slot = find_slot(t, key, tag_hash(key));
+    if (slot == t->cap) {
+        return 0;
+    }
+    return &dynarray_get(Entry)(&t->entries, index_get(t, slot))->val;
+}
+
+bool table_get(const Table *t, Tag key, Tag *val) {
+    Tag *found = find_val(t, key);
+    if (!found) {
         return false;
     }
     if (val) {
-        *val = entry->val;
+        *val = *found;
     }
     return true;
 }
 
+Tag *table_get_slot(Table *t, Tag key) {
+    if (t->frozen) {
+        thaw(t);
+    }
+    return find_val(t, key);
+}
+
 bool table_del(Table *t, Tag key) {
-    assert(!is_unset(key) && "table keys cannot be user symbols 0 or 1");
+    if (t->frozen) {
+        thaw(t);
+    }
+    size_t len = dynarray_len(Tag)(&t->array);
+    if (len) {
+        size_t idx;
+        if (!array_index(key, &idx) || idx >= len) {
+            return false;
+        }
+        if (idx + 1 < len) {
+            array_to_hash(t);
+        } else {
+            tag_free(*dynarray_get(Tag)(&t->array, idx));
+            dynarray_trunc(Tag)(&t->array, idx);
+            if (idx == 0) {
+                dynarray_destroy(Tag)(&t->array);
+            }
+            return true;
+        }
+    }
     if (t->real_len == 0) {
         return false;
     }
-    Entry *entry = find_entry(t, key);
-    if (is_unset(entry->key)) {
+    if (t->cap == 0) {
+        size_t pos = small_find(t, key);
+        if (pos == t->real_len) {
+            return false;
+        }
+        Entry *entry = dynarray_get(Entry)(&t->entries, pos);
+        tag_free(entry->key);
+        tag_free(entry->val);
+        memmove(entry, entry + 1, (t->real_len - pos - 1) * sizeof(*entry));
+        t->real_len--;
+        dynarray_trunc(Entry)(&t->entries, t->real_len);
+        if (t->real_len == 0) {
+            dynarray_destroy(Entry)(&t->entries);
+        }
+        return true;
+    }
+    size_t slot = find_slot(t, key, tag_hash(key));
+    if (slot == t->cap) {
         return false;
     }
+    size_t pos = index_get(t, slot);
+    Entry *entry = dynarray_get(Entry)(&t->entries, pos);
     tag_free(entry->key);
     tag_free(entry->val);
-    entry->key = TOMBSTONE_KEY;
+    entry->key = HOLE_KEY;
+    if (pos + 1 == dynarray_len(Entry)(&t->entries)) {
+        dynarray_trunc(Entry)(&t->entries, pos);
+    }
+    // Lookups already stop at a group with an empty slot, so no key was placed past it and
+    // the slot can become empty again.
+    if (group_match(&t->ctrl[slot & ~(size_t)(GROUP - 1)], CTRL_EMPTY)) {
+        t->ctrl[slot] = CTRL_EMPTY;
+    } else {
+        t->ctrl[slot] = CTRL_DELETED;
+        t->deleted++;
+    }
     t->real_len--;
+    if (t->real_len == 0) {
+        dynarray_destroy(Entry)(&t->entries);
+        free_index(t);
+    } else if (t->real_len <= SMALL_MAX / 2) {
+        hash_to_small(t);
+    } else if (t->cap > MIN_CAP && t->real_len < t->cap / 8) {
+        // Shrink until the live entries fill between a quarter and a half of the index. It
+        // takes at least cap/8 deletes to shrink again and 3*cap/8 sets to resize again, which
+        // keeps both amortized O(1).
+        size_t cap = t->cap;
+        while (cap > MIN_CAP && t->real_len <= cap / 4) {
+            cap /= 2;
+        }
+        resize(t, cap);
+    }
     return true;
 }
 
+bool table_next(const Table *t, size_t *pos, Tag *key, Tag *val) {
+    // positions count the array part first, only one of the two parts is used at a time
+    size_t array_len = dynarray_len(Tag)(&t->array);
+    if (*pos < array_len) {
+        *key = i49_to_tag(*pos);
+        *val = *dynarray_get(Tag)(&t->array, *pos);
+        (*pos)++;
+        return true;
+    }
+    size_t len = t->frozen ? t->frozen->len : dynarray_len(Entry)(&t->entries);
+    for (size_t i = *pos - array_len; i < len; i++) {
+        const Entry *entry = entry_at(t, i);
+        if (!is_hole(entry)) {
+            *key = entry->key;
+            *val = entry->val;
+            *pos = array_len + i + 1;
+            return true;
+        }
+    }
+    *pos = array_len + len;
+    return false;
+}
+
 void table_destroy(Table *t) {
-    assert(t->real_len < dynarray_cap(Entry)(&t->array) || t->real_len == 0);
-    size_t remaining = t->real_len;
-    for (size_t i = 0; remaining; i++) {
-        Entry *entry = dynarray_get(Entry)(&t->array, i);
-        if (is_unset(entry->key)) {
+    if (t->frozen) {
+        frozen_release(t->frozen);
+        t->frozen = 0;
+        t->real_len = 0;
+        return;
+    }
+    for (size_t i = 0; i < dynarray_len(Tag)(&t->array); i++) {
+        tag_free(*dynarray_get(Tag)(&t->array, i));
+    }
+    dynarray_destroy(Tag)(&t->array);
+    size_t len = dynarray_len(Entry)(&t->entries);
+    for (size_t i = 0; i < len; i++) {
+        Entry *entry = dynarray_get(Entry)(&t->entries, i);
+        if (is_hole(entry)) {
             continue;
         }
-        remaining--;
         tag_free(entry->key);
         tag_free(entry->val);
     }
-    dynarray_destroy(Entry)(&t->array);
+    dynarray_destroy(Entry)(&t->entries);
+    free_index(t);
     t->real_len = 0;
 }
 
@@ -202,12 +797,20 @@ void table_free(Table *t) {
 }
 
 void table_printf(FILE *f, const Table *t) {
-    assert(t->real_len < dynarray_cap(Entry)(&t->array) || t->real_len == 0);
     fputc('{', f);
-    size_t remaining = t->real_len;
+    size_t remaining = table_len(t);
+    for (size_t i = 0; i < dynarray_len(Tag)(&t->array); i++) {
+        remaining--;
+        tag_reprf(f, i49_to_tag(i));
+        fputs(": ", f);
+        tag_reprf(f, *dynarray_get(Tag)(&t->array, i));
+        if (remaining > 0) {
+            fputs(", ", f);
+        }
+    }
     for (size_t i = 0; remaining; i++) {
-        Entry *entry = dynarray_get(Entry)(&t->array, i);
-        if (is_unset(entry->key)) {
+        const Entry *entry = entry_at(t, i);
+        if (is_hole(entry)) {
             continue;
         }
         remaining--;
@@ -222,15 +825,22 @@ void table_printf(FILE *f, const Table *t) {
 }
 
 bool table_eq(const Table *a, const Table *b) {
-    assert(a->real_len < dynarray_cap(Entry)(&a->array) || a->real_len == 0);
-    assert(b->real_len < dynarray_cap(Entry)(&b->array) || b->real_len == 0);
-    if (a->real_len != b->real_len) {
+    if (table_len(a) != table_len(b)) {
         return false;
     }
+    for (size_t i = 0; i < dynarray_len(Tag)(&a->array); i++) {
+        Tag val;
+        if (!table_get(b, i49_to_tag(i), &val)) {
+            return false;
+        }
+        if (!tag_eq(*dynarray_get(Tag)(&a->array, i), val)) {
+            return false;
+        }
+    }
     size_t remaining = a->real_len;
     for (size_t i = 0; remaining; i++) {
-        Entry *entry = dynarray_get(Entry)(&a->array, i);
-        if (is_unset(entry->key)) {
+        const Entry *entry = entry_at(a, i);
+        if (is_hole(entry)) {
             continue;
         }
         remaining--;
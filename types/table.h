@@ -2,6 +2,7 @@
 #define slang_table_h
 
 #include "dynarray.h" // dynarray_*
+#include "list.h"     // DynamicArray(Tag)
 #include "tag.h"      // Tag
 
 #include <stdbool.h>
@@ -12,13 +13,29 @@
 typedef struct Entry {
     Tag key;
     Tag val;
+    size_t hash; // cached tag_hash(key)
 } Entry;
 
 dynarray_declare(Entry);
 
+typedef struct Frozen Frozen;
+
+// Table keeps its entries densely in insertion order, and finds them through an open addressing
+// index probed in groups of 16 slots. Each index slot has a control byte that is either empty,
+// deleted, or holds 7 bits of the key's hash, so most mismatching slots are rejected without
+// touching the entries. The entry positions stored in the index are 1, 2, 4 or 8 bytes wide,
+// depending on the index size. Tables with at most 8 entries have no index at all and are
+// searched linearly. While the hash part is empty, values for the keys 0..n-1 are stored
+// directly in the array part instead. Frozen tables share read-only entries behind a minimal
+// perfect hash, and copy them into a regular table on their first write.
 typedef struct Table {
-    DynamicArray(Entry) array;
+    DynamicArray(Tag) array;
+    DynamicArray(Entry) entries; // deleted entries are left as holes until the next resize
+    uint8_t *ctrl;               // cap control bytes followed by cap entry positions
+    size_t cap;                  // 0 for small tables
+    size_t deleted;              // deleted control bytes, they use up empty slots like entries
     size_t real_len;
+    Frozen *frozen; // shared entries of frozen tables, 0 otherwise
 } Table;
 
 bool table_eq(const Table *, const Table *);
@@ -28,17 +45,29 @@ void table_printf(FILE *, const Table *);
 inline void table_print(const Table *t) { table_printf(stdout, t); }
 bool table_set(Table *, Tag key, Tag val);
 bool table_get(const Table *, Tag key, Tag *val);
+Tag *table_get_slot(Table *, Tag key); // the value of key, valid until the next write, or 0
 bool table_del(Table *, Tag);
+// table_next() walks the entries in insertion order. Starting with *pos = 0, each call returns
+// the next entry and moves *pos past it, until it returns false. Writes that change the table's
+// length invalidate *pos.
+bool table_next(const Table *, size_t *pos, Tag *key, Tag *val);
+void table_reserve(Table *, size_t len); // presizes an empty table's hash part for len entries
+bool table_freeze(Table *);                // fails if no perfect hash is found
+void table_share(Table *, const Table *frozen);
 
-inline size_t table_len(const Table *t) { return t->real_len; }
+inline size_t table_len(const Table *t) { return dynarray_len(Tag)(&t->array) + t->real_len; }
+size_t table_bytes(const Table *); // memory used by entries and the index
 
 // SLANG_DEBUG
 typedef struct TableStats {
     uint64_t queries;
-    uint64_t collisions;
+    uint64_t collisions; // hash fragment matches with a different key
+    uint64_t probes;    // groups visited by all queries, average = probes / queries
+    uint64_t max_probe; // longest single query
 } TableStats;
 
 void table_print_summary(const Table *);
 TableStats table_stats(void);
+void table_stats_reset(void);
 
 #endif
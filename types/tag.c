@@ -1,8 +1,10 @@
 #include "tag.h"
 
+#include "dtoa.h"     // dtoa, DTOA_MAX
 #include "fun.h"      // Fun, fun_*
 #include "list.h"     // List, list_*
 #include "mem.h"      // mem_*
+#include "range.h"    // Range, range_*
 #include "safemath.h" // i64_*_over
 #include "str.h"      // String, Slice, string_*, slice_*
 #include "table.h"    // Table, table_*
@@ -15,6 +17,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #define SAFE_CAST(FROM, TO, VAL)                                                                   \
     (union {                                                                                       \
@@ -39,6 +42,71 @@ static Tag error(const char *fmt, ...) {
     return error_to_tag(error);
 }
 
+// Boxed ints are carved out of slabs of I64_SLAB cells instead of being allocated one by one, and
+// freed boxes are kept on a free list threaded through the cells themselves. Slabs are never
+// released while in use, they are destroyed all at once by i64_pool_destroy().
+#define I64_SLAB 1024
+
+typedef union I64Cell {
+    int64_t i;
+    union I64Cell *next;
+} I64Cell;
+
+typedef struct I64Slab {
+    struct I64Slab *next;
+    I64Cell cells[I64_SLAB];
+} I64Slab;
+
+static struct {
+    I64Slab *slabs;
+    size_t used; // cells handed out from the newest slab
+    I64Cell *free;
+#ifdef SLANG_DEBUG
+    size_t live; // cells handed out and not released, the slabs hide them from mem_stats
+#endif
+} i64_pool = {0};
+
+static int64_t *i64_alloc(void) {
+#ifdef SLANG_DEBUG
+    i64_pool.live++;
+#endif
+    I64Cell *cell = i64_pool.free;
+    if (cell) {
+        i64_pool.free = cell->next;
+        return &cell->i;
+    }
+    if (!i64_pool.slabs || i64_pool.used == I64_SLAB) {
+        I64Slab *slab = mem_allocate(sizeof(*slab));
+        slab->next = i64_pool.slabs;
+        i64_pool.slabs = slab;
+        i64_pool.used = 0;
+    }
+    return &i64_pool.slabs->cells[i64_pool.used++].i;
+}
+
+static void i64_release(int64_t *i) {
+#ifdef SLANG_DEBUG
+    assert(i64_pool.live && "boxed int released twice");
+    i64_pool.live--;
+#endif
+    I64Cell *cell = (I64Cell *)i;
+    cell->next = i64_pool.free;
+    i64_pool.free = cell;
+}
+
+void i64_pool_destroy(void) {
+#ifdef SLANG_DEBUG
+    assert(i64_pool.live == 0 && "unfreed boxed ints");
+#endif
+    while (i64_pool.slabs) {
+        I64Slab *next = i64_pool.slabs->next;
+        mem_free(i64_pool.slabs, sizeof(*i64_pool.slabs));
+        i64_pool.slabs = next;
+    }
+    i64_pool.used = 0;
+    i64_pool.free = 0;
+}
+
 void tag_free_ptr(Tag t) {
     assert(tag_is_own(t));
     switch (tag_type(t)) {
@@ -51,11 +119,9 @@ void tag_free_ptr(Tag t) {
     case TYPE_LIST:
         list_free(tag_to_list(t));
         break;
-    case TYPE_I64: {
-        int64_t *i = tag_to_i64(t);
-        mem_free(i, sizeof(*i));
+    case TYPE_I64:
+        i64_release(tag_to_i64(t));
         break;
-    }
     case TYPE_ERROR: {
         Tag *error = tag_to_error(t);
         t = *error;
@@ -69,14 +135,68 @@ void tag_free_ptr(Tag t) {
     case TYPE_FUN:
         fun_free(tag_to_fun(t));
         break;
+    case TYPE_RANGE:
+        range_free(tag_to_range(t));
+        break;
     case TYPE_I49P:
     case TYPE_I49N:
     case TYPE_SYMBOL:
+    case TYPE_SHORT_STR:
     case TYPE_DOUBLE:
         assert(0 && "free on data tags");
     }
 }
 
+Tag str_view(Tag parent, const char *c, size_t len) {
+    if (len <= SHORT_STR_MAX) {
+        return short_str_to_tag(c, len);
+    }
+    if (tag_is_slice(parent)) {
+        Slice *s = tag_to_slice(parent);
+        return len == s->len ? tag_to_ref(parent) : slice_to_tag(slice_view(s, c - s->c, len));
+    }
+    String *s = tag_to_string(parent);
+    return len == s->len ? tag_to_ref(parent) : slice_to_tag(string_view(s, c - s->c, len));
+}
+
+bool as_str(Tag t, char *buf, const char **c, size_t *len) {
+    switch (tag_type(t)) {
+    case TYPE_STRING: {
+        String *s = tag_to_string(t);
+        *c = s->c;
+        *len = s->len;
+        return true;
+    }
+    case TYPE_SLICE: {
+        Slice *s = tag_to_slice(t);
+        *c = s->c;
+        *len = s->len;
+        return true;
+    }
+    case TYPE_SHORT_STR:
+        *c = buf;
+        *len = short_str_chars(t, buf);
+        return true;
+    default:
+        return false;
+    }
+}
+
+// concat() returns a short string if the result fits, a StrBuf backed Slice for long results, and a
+// new String otherwise
+static Tag concat(const char *l, size_t l_len, const char *r, size_t r_len) {
+    if (l_len + r_len >= STR_BUILD_MIN) {
+        return slice_to_tag(str_build(l, l_len, r, r_len));
+    }
+    if (l_len + r_len <= SHORT_STR_MAX) {
+        char buf[SHORT_STR_MAX];
+        memcpy(buf, l, l_len);
+        memcpy(buf + l_len, r, r_len);
+        return short_str_to_tag(buf, l_len + r_len);
+    }
+    return string_to_tag(str_concat(l, l_len, r, r_len));
+}
+
 static const char *symbols[] = {"<false>", "<true>", "<nil>", "<ok>"};
 static void print(FILE *f, Tag t, bool is_repr) {
     // TODO: OK to ignore output errors?
@@ -114,9 +234,12 @@ static void print(FILE *f, Tag t, bool is_repr) {
     case TYPE_FUN:
         fun_printf(f, tag_to_fun(t));
         break;
+    case TYPE_RANGE:
+        range_printf(f, tag_to_range(t));
+        break;
     case TYPE_DOUBLE: {
-        double d = tag_to_double(t);
-        fprintf(f, floor(d) == d ? "%.1f" : "%.16g", d);
+        char buf[DTOA_MAX];
+        fwrite(buf, sizeof(buf[0]), dtoa(tag_to_double(t), buf), f);
         break;
     }
     case TYPE_SYMBOL: {
@@ -132,6 +255,18 @@ static void print(FILE *f, Tag t, bool is_repr) {
     case TYPE_I49N:
         fprintf(f, "%" PRId64, tag_to_i49(t));
         break;
+    case TYPE_SHORT_STR: {
+        char buf[SHORT_STR_MAX];
+        size_t len = short_str_chars(t, buf);
+        if (is_repr) {
+            putc('"', f);
+        }
+        fwrite(buf, sizeof(buf[0]), len, f);
+        if (is_repr) {
+            putc('"', f);
+        }
+        break;
+    }
     }
 #ifdef SLANG_DEBUG
     if (is_repr && tag_is_ptr(t)) {
@@ -144,35 +279,74 @@ static void print(FILE *f, Tag t, bool is_repr) {
 void tag_printf(FILE *f, Tag t) { print(f, t, false); }
 void tag_reprf(FILE *f, Tag t) { print(f, t, true); }
 
-static size_t int_hash(uint64_t i) { return i * 13 + 37; }
+// The murmur3 64-bit finalizer. Every input bit affects every output bit, so sequential and
+// strided keys spread over the whole table instead of clustering under the power-of-two mask.
+static size_t mix_hash(uint64_t h) {
+    h ^= h >> 33;
+    h *= UINT64_C(0xff51afd7ed558ccd);
+    h ^= h >> 33;
+    h *= UINT64_C(0xc4ceb9fe1a85ec53);
+    h ^= h >> 33;
+    return h;
+}
+static size_t ptr_hash(const void *p, uint64_t seed) { return mix_hash((uintptr_t)p ^ seed); }
 size_t tag_hash(Tag t) {
     switch (tag_type(t)) {
     case TYPE_STRING:
         return 0xFEEDFEED ^ string_hash(tag_to_string(t));
     case TYPE_TABLE:
     case TYPE_LIST:
-        return 0xDEADBEEF ^ (((uintptr_t)tag_to_ptr(t)) >> sizeof(max_align_t));
+        return ptr_hash(tag_to_ptr(t), 0xDEADBEEF);
     case TYPE_I64:
-        return int_hash(SAFE_CAST(int64_t, uint64_t, *tag_to_i64(t)));
+        return mix_hash(SAFE_CAST(int64_t, uint64_t, *tag_to_i64(t)));
     case TYPE_ERROR:
         return 0xC0FFEE ^ tag_hash(*tag_to_error(t));
     case TYPE_SLICE:
         return 0xFEEDFEED ^ slice_hash(tag_to_slice(t));
     case TYPE_FUN:
-        return 0xBAD0F00D ^ (((uintptr_t)tag_to_ptr(t)) >> sizeof(max_align_t));
+        return ptr_hash(tag_to_ptr(t), 0xBAD0F00D);
+    case TYPE_RANGE:
+        return mix_hash(0xFACADE ^ range_hash(tag_to_range(t)));
     case TYPE_DOUBLE: {
         double d = tag_to_double(t);
         if (d == (int64_t)d) {
-            return int_hash(SAFE_CAST(int64_t, uint64_t, d));
+            return mix_hash(SAFE_CAST(int64_t, uint64_t, d));
         }
-        return SAFE_CAST(double, size_t, d);
+        return mix_hash(SAFE_CAST(double, uint64_t, d));
     }
     case TYPE_SYMBOL:
-        return 0xCACA0 ^ (tag_to_symbol(t) * 31 + 37);
+        return mix_hash(0xCACA0 ^ tag_to_symbol(t));
     case TYPE_I49P:
     case TYPE_I49N:
-        return int_hash(SAFE_CAST(int64_t, uint64_t, tag_to_i49(t)));
+        return mix_hash(SAFE_CAST(int64_t, uint64_t, tag_to_i49(t)));
+    case TYPE_SHORT_STR: {
+        // must match the hash of equal Strings and Slices
+        char buf[SHORT_STR_MAX];
+        size_t len = short_str_chars(t, buf);
+        return 0xFEEDFEED ^ str_hash(buf, len);
     }
+    }
+}
+
+Tag tag_intern(Tag t) {
+    char buf[SHORT_STR_MAX];
+    const char *c;
+    size_t len;
+    if (tag_is_short_str(t) || !as_str(t, buf, &c, &len)) {
+        return t;
+    }
+    Tag result;
+    if (len <= SHORT_STR_MAX) {
+        result = short_str_to_tag(c, len);
+    } else if (tag_is_string(t) && tag_is_own(t)) {
+        return tag_to_ref(string_to_tag(string_intern(tag_to_string(t))));
+    } else if (tag_is_string(t) && tag_to_string(t)->interned) {
+        return t;
+    } else {
+        result = tag_to_ref(string_to_tag(str_intern(c, len)));
+    }
+    tag_free(t);
+    return result;
 }
 
 bool tag_is_true(Tag t) {
@@ -191,6 +365,8 @@ bool tag_is_true(Tag t) {
         return slice_len(tag_to_slice(t));
     case TYPE_FUN:
         return true;
+    case TYPE_RANGE:
+        return range_len(tag_to_range(t));
     case TYPE_DOUBLE:
         return tag_to_double(t);
     case TYPE_SYMBOL:
@@ -204,6 +380,8 @@ bool tag_is_true(Tag t) {
     case TYPE_I49P:
     case TYPE_I49N:
         return tag_to_i49(t);
+    case TYPE_SHORT_STR:
+        return short_str_len(t);
     }
 }
 
@@ -222,6 +400,8 @@ bool tag_eq(Tag a, Tag b) {
             return string_eq_string(tag_to_string(a), tag_to_string(b));
         case TYPE_SLICE:
             return string_eq_slice(tag_to_string(a), tag_to_slice(b));
+        case TYPE_SHORT_STR:
+            return tag_eq(b, a);
         default:
             return false;
         }
@@ -249,11 +429,15 @@ bool tag_eq(Tag a, Tag b) {
             return string_eq_slice(tag_to_string(b), tag_to_slice(a));
         case TYPE_SLICE:
             return slice_eq_slice(tag_to_slice(a), tag_to_slice(b));
+        case TYPE_SHORT_STR:
+            return tag_eq(b, a);
         default:
             return false;
         }
     case TYPE_FUN:
         return tag_is_fun(b) && tag_to_ptr(a) == tag_to_ptr(b);
+    case TYPE_RANGE:
+        return tag_is_range(b) && range_eq(tag_to_range(a), tag_to_range(b));
     case TYPE_DOUBLE:
         switch (tag_type(b)) {
         case TYPE_I64:
@@ -281,11 +465,24 @@ bool tag_eq(Tag a, Tag b) {
         }
     case TYPE_SYMBOL:
         return false; // should be tag_biteq() called at the top
+    case TYPE_SHORT_STR: {
+        if (tag_is_short_str(b)) {
+            return false; // should be tag_biteq() called at the top
+        }
+        char buf[SHORT_STR_MAX];
+        const char *a_c, *b_c;
+        size_t a_len, b_len;
+        as_str(a, buf, &a_c, &a_len);
+        if (!as_str(b, 0, &b_c, &b_len)) {
+            return false;
+        }
+        return a_len == b_len && memcmp(a_c, b_c, a_len) == 0;
+    }
     }
 }
 
 Tag i64_new(int64_t i) {
-    int64_t *p = mem_allocate(sizeof(*p));
+    int64_t *p = i64_alloc();
     *p = i;
     return i64_to_tag(p);
 }
@@ -398,59 +595,31 @@ static Tag add_double(double left, double right) { return double_to_tag(left + r
 Tag tag_add(Tag left, Tag right) {
     switch (tag_type(left)) {
         BINARY_MATH(add_i64_reuse, add_i64, add_i49, add_double)
-    case TYPE_SLICE: {
-        Slice *l = tag_to_slice(left);
-        switch (tag_type(right)) {
-        case TYPE_SLICE: {
-            Slice *r = tag_to_slice(right);
-            Tag result = string_to_tag(str_concat(l->c, l->len, r->c, r->len));
-            tag_free(left);
-            tag_free(right);
-            return result;
-        }
-        case TYPE_STRING: {
-            String *r = tag_to_string(right);
-            Tag result = string_to_tag(str_concat(l->c, l->len, r->c, r->len));
-            tag_free(left);
-            tag_free(right);
-            return result;
-        }
-        default:
+    case TYPE_STRING:
+    case TYPE_SLICE:
+    case TYPE_SHORT_STR: {
+        char l_buf[SHORT_STR_MAX], r_buf[SHORT_STR_MAX];
+        const char *l, *r;
+        size_t l_len, r_len;
+        if (!as_str(right, r_buf, &r, &r_len)) {
             break;
         }
-        break;
-    }
-    case TYPE_STRING: {
-        String *l = tag_to_string(left);
-        switch (tag_type(right)) {
-        case TYPE_SLICE: {
-            String *result;
-            Slice *r = tag_to_slice(right);
-            if (tag_is_own(left)) {
-                result = string_append(l, r->c, r->len);
-            } else {
-                result = str_concat(l->c, l->len, r->c, r->len);
-                // tag_free(left) -- not owned
-            }
-            tag_free(right);
-            return string_to_tag(result);
-        }
-        case TYPE_STRING: {
-            String *result;
-            String *r = tag_to_string(right);
-            if (tag_is_own(left)) {
-                result = string_append(l, r->c, r->len);
-            } else {
-                result = str_concat(l->c, l->len, r->c, r->len);
-                // tag_free(left) -- not owned
-            }
+        if (tag_is_string(left) && tag_is_own(left)) {
+            String *result = string_append(tag_to_string(left), r, r_len);
             tag_free(right);
             return string_to_tag(result);
         }
-        default:
-            break;
+        Slice *extended = tag_is_slice(left) ? slice_extend(tag_to_slice(left), r, r_len) : 0;
+        Tag result;
+        if (extended) {
+            result = slice_to_tag(extended);
+        } else {
+            as_str(left, l_buf, &l, &l_len);
+            result = concat(l, l_len, r, r_len);
         }
-        break;
+        tag_free(left);
+        tag_free(right);
+        return result;
     }
     default:
         break;
@@ -588,49 +757,20 @@ Tag tag_mod(Tag left, Tag right) {
 }
 
 #define STR_CMP(cmpf)                                                                              \
-    case TYPE_STRING: {                                                                            \
-        String *l = tag_to_string(left);                                                           \
-        switch (tag_type(right)) {                                                                 \
-        case TYPE_STRING: {                                                                        \
-            String *r = tag_to_string(right);                                                      \
-            Tag result = cmpf(l->c, l->len, r->c, r->len);                                         \
-            tag_free(left);                                                                        \
-            tag_free(right);                                                                       \
-            return result;                                                                         \
-        }                                                                                          \
-        case TYPE_SLICE: {                                                                         \
-            Slice *r = tag_to_slice(right);                                                        \
-            Tag result = cmpf(l->c, l->len, r->c, r->len);                                         \
-            tag_free(left);                                                                        \
-            tag_free(right);                                                                       \
-            return result;                                                                         \
-        }                                                                                          \
-        default:                                                                                   \
-            break;                                                                                 \
-        }                                                                                          \
-        break;                                                                                     \
-    }                                                                                              \
-    case TYPE_SLICE: {                                                                             \
-        Slice *l = tag_to_slice(left);                                                             \
-        switch (tag_type(right)) {                                                                 \
-        case TYPE_STRING: {                                                                        \
-            String *r = tag_to_string(right);                                                      \
-            Tag result = cmpf(l->c, l->len, r->c, r->len);                                         \
-            tag_free(left);                                                                        \
-            tag_free(right);                                                                       \
-            return result;                                                                         \
-        }                                                                                          \
-        case TYPE_SLICE: {                                                                         \
-            Slice *r = tag_to_slice(right);                                                        \
-            Tag result = cmpf(l->c, l->len, r->c, r->len);                                         \
-            tag_free(left);                                                                        \
-            tag_free(right);                                                                       \
-            return result;                                                                         \
-        }                                                                                          \
-        default:                                                                                   \
+    case TYPE_STRING:                                                                              \
+    case TYPE_SLICE:                                                                               \
+    case TYPE_SHORT_STR: {                                                                         \
+        char l_buf[SHORT_STR_MAX], r_buf[SHORT_STR_MAX];                                           \
+        const char *l, *r;                                                                         \
+        size_t l_len, r_len;                                                                       \
+        if (!as_str(right, r_buf, &r, &r_len)) {                                                   \
             break;                                                                                 \
         }                                                                                          \
-        break;                                                                                     \
+        as_str(left, l_buf, &l, &l_len);                                                           \
+        Tag result = cmpf(l, l_len, r, r_len);                                                     \
+        tag_free(left);                                                                            \
+        tag_free(right);                                                                           \
+        return result;                                                                             \
     }
 
 static Tag less_i64(int64_t left, int64_t right) { return left < right ? TAG_TRUE : TAG_FALSE; }
@@ -712,8 +852,9 @@ Tag tag_negate(Tag t) {
     }
 }
 
-const char *tag_type_names[] = {"String", "Table", "List",  "Integer", "Integer",  "Integer",
-                                "Symbol", "",      "Error", "String",  "Function", "Float"};
+const char *tag_type_names[] = {"String", "Table",  "List",  "Integer",  "Integer", "Integer",
+                                "Symbol", "String", "Error", "String",   "Function", "Range",
+                                "Float"};
 
 extern inline bool tag_biteq(Tag, Tag);
 extern inline bool tag_is_ptr(Tag);
@@ -750,6 +891,9 @@ extern inline Slice *tag_to_slice(Tag);
 extern inline bool tag_is_fun(Tag);
 extern inline Tag fun_to_tag(const Fun *);
 extern inline Fun *tag_to_fun(Tag);
+extern inline bool tag_is_range(Tag);
+extern inline Tag range_to_tag(const Range *);
+extern inline Range *tag_to_range(Tag);
 
 extern inline bool tag_is_i49(Tag);
 extern inline Tag i49_to_tag(int64_t);
@@ -761,6 +905,11 @@ extern inline Tag int_to_tag(int64_t);
 extern inline bool tag_is_symbol(Tag);
 extern inline Symbol tag_to_symbol(Tag);
 
+extern inline bool tag_is_short_str(Tag);
+extern inline Tag short_str_to_tag(const char *, size_t);
+extern inline size_t short_str_len(Tag);
+extern inline size_t short_str_chars(Tag, char *);
+
 extern inline bool tag_is_double(Tag);
 extern inline Tag double_to_tag(double);
 extern inline double tag_to_double(Tag);
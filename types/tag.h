@@ -11,7 +11,8 @@
 // A Tag is a discriminated union of all known Slang types.
 //
 // It uses NaN tagging to pack pointers and their type discriminant together. Tags can also embed a
-// few small primitives, like floats, 49 bit inegers, and symbols, to save dereferences.
+// few small primitives, like floats, 49 bit inegers, symbols, and short strings, to save
+// dereferences.
 //
 // All types, except doubles (because of their NaNs), havethe following invariant: two values are
 // equal if their tags are equal bitwise. The reverse in not necessarily true--eg., two pointers can
@@ -34,6 +35,7 @@ typedef struct Table Table;
 typedef struct List List;
 typedef struct Slice Slice;
 typedef struct Fun Fun;
+typedef struct Range Range;
 
 inline bool tag_biteq(Tag a, Tag b) { return a.u == b.u; }
 
@@ -149,6 +151,7 @@ inline int64_t *tag_to_i64(Tag t) {
     return (int64_t *)tag_to_ptr(t);
 }
 Tag i64_new(int64_t);
+void i64_pool_destroy(void); // frees the boxed ints memory, debug builds check none are live
 
 #define ERROR_DISCRIMINANT BYTES(7f, fc, 00, 00, 00, 00, 00, 00)
 inline bool tag_is_error(Tag t) { return ((t.u & DISCRIMINANT_MASK) == ERROR_DISCRIMINANT); }
@@ -183,8 +186,18 @@ inline Fun *tag_to_fun(Tag t) {
     return (Fun *)tag_to_ptr(t);
 }
 
-// There is one pointer tags left:
-// 01111111|11111111|........|........|........|........|........|.......o
+#define RANGE_DISCRIMINANT BYTES(7f, ff, 00, 00, 00, 00, 00, 00)
+inline bool tag_is_range(Tag t) { return ((t.u & DISCRIMINANT_MASK) == RANGE_DISCRIMINANT); }
+inline Tag range_to_tag(const Range *r) {
+    assert(((uintptr_t)r & DISCRIMINANT_MASK) == 0);
+    return (Tag){.u = (uintptr_t)r | RANGE_DISCRIMINANT};
+}
+inline Range *tag_to_range(Tag t) {
+    assert(tag_is_range(t));
+    return (Range *)tag_to_ptr(t);
+}
+
+// All the pointer tags are used.
 
 // Other than the pointer tags, we define a few data tags which embed their values directly in the
 // tag. These tags have the most significant discriminant bit (the sign bit) set to 1.
@@ -244,7 +257,7 @@ static_assert(0xfff6000000000000 == SYMBOL_DISCRIMINANT, "symbol constant change
 #define TAG_NIL ((Tag){.u = (0xfff6000000000000) | SYM_NIL})
 #define TAG_OK ((Tag){.u = (0xfff6000000000000) | SYM_OK})
 
-#define USER_SYMBOL(x) ((Tag){.u = (0xfff5000000000000 | ((x) + SYM__COUNT))})
+#define USER_SYMBOL(x) ((Tag){.u = (0xfff6000000000000 | ((x) + SYM__COUNT))})
 
 inline Symbol tag_to_symbol(Tag t) {
     assert(tag_is_symbol(t));
@@ -257,8 +270,40 @@ inline bool tag_is_double(Tag t) { return (t.u & TAGGED_MASK) != TAGGED_MASK; }
 inline double tag_to_double(Tag t) { return t.d; }
 inline Tag double_to_tag(double d) { return (Tag){.d = d}; }
 
-// There are five data tags left:
-// 11111111|11110111|........|........|........|........|........|........
+// Short strings embed up to SHORT_STR_MAX chars directly in the tag, saving an allocation and a
+// dereference for small values like dictionary keys. The length is stored in the most significant
+// payload byte, followed by the chars starting with the least significant byte. Unused bytes are
+// always zero, so equal short strings are equal bitwise.
+#define SHORT_STR_DISCRIMINANT BYTES(ff, f7, 00, 00, 00, 00, 00, 00)
+#define SHORT_STR_MAX 5
+inline bool tag_is_short_str(Tag t) {
+    return ((t.u & DISCRIMINANT_MASK) == SHORT_STR_DISCRIMINANT);
+}
+
+inline Tag short_str_to_tag(const char *c, size_t len) {
+    assert(len <= SHORT_STR_MAX && "short string too long");
+    uint64_t u = (uint64_t)len << 40;
+    for (size_t i = 0; i < len; i++) {
+        u |= (uint64_t)(unsigned char)c[i] << (8 * i);
+    }
+    return (Tag){.u = u | SHORT_STR_DISCRIMINANT};
+}
+
+inline size_t short_str_len(Tag t) {
+    assert(tag_is_short_str(t));
+    return (t.u >> 40) & 0xff;
+}
+
+// short_str_chars() unpacks the chars into buf, which must fit at least SHORT_STR_MAX chars.
+inline size_t short_str_chars(Tag t, char *buf) {
+    size_t len = short_str_len(t);
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = (char)(t.u >> (8 * i));
+    }
+    return len;
+}
+
+// There are four data tags left:
 // 11111111|11111100|........|........|........|........|........|........
 // 11111111|11111101|........|........|........|........|........|........
 // 11111111|11111110|........|........|........|........|........|........
@@ -272,10 +317,12 @@ typedef enum { // careful, this order isn't trivial to figure out
     TYPE_I49P,
     TYPE_I49N,
     TYPE_SYMBOL,
-    TYPE_ERROR = 8,
+    TYPE_SHORT_STR,
+    TYPE_ERROR,
     TYPE_SLICE,
     TYPE_FUN,
-    TYPE_DOUBLE, // this comes last
+    TYPE_RANGE,
+    TYPE_DOUBLE, // this comes last, the four data tags left would be 12 to 15 if they were used
 } TagType;
 
 // tag_type() returns the type discriminant
@@ -305,6 +352,10 @@ void tag_reprf(FILE *, Tag);
 inline void tag_repr(Tag t) { tag_reprf(stdout, t); }
 size_t tag_hash(Tag);
 
+// tag_intern() canonicalizes strings: short ones become short strings and the rest are replaced by
+// a reference to their interned String. It takes ownership of the tag, non-strings pass through.
+Tag tag_intern(Tag);
+
 bool tag_eq(Tag, Tag);
 
 bool tag_is_true(Tag);
@@ -325,6 +376,14 @@ inline bool as_int(Tag src, int64_t *dst) {
     return false;
 }
 
+// as_str() exposes the chars of any string type, short strings are unpacked into buf which must fit
+// at least SHORT_STR_MAX chars
+bool as_str(Tag, char *buf, const char **c, size_t *len);
+// str_view() returns the len chars at c, which point into the string parent, without copying them.
+// Views of Slices share the Slice's StrBuf and views of Strings borrow them, see string_view().
+// Views that fit a short string are copied anyway, and a view of the whole parent is a ref to it.
+Tag str_view(Tag parent, const char *c, size_t len);
+
 // Binary math
 Tag tag_add(Tag, Tag);
 Tag tag_mul(Tag, Tag);
@@ -347,8 +406,10 @@ Tag tag_negate(Tag);
 #undef ERROR_DISCRIMINANT
 #undef SLICE_DISCRIMINANT
 #undef FUN_DISCRIMANANT
+#undef RANGE_DISCRIMINANT
 #undef I49_DISCRIMINANT
 #undef I49_SIGN
 #undef SYMBOL_DISCRIMINANT
+#undef SHORT_STR_DISCRIMINANT
 
 #endif
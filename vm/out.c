@@ -0,0 +1,117 @@
+#include "out.h"
+
+#include "dtoa.h" // dtoa, itoa
+#include "mem.h"  // mem_allocate, mem_free
+#include "str.h"  // String, Slice
+#include "tag.h"  // Tag, tag_*
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h> // isatty
+#define IS_TERMINAL(f) isatty(fileno(f))
+#else
+#define IS_TERMINAL(f) false
+#endif
+
+// the VM is single threaded, so there's no need to lock the FILE for every block
+#ifdef __GLIBC__
+#define WRITE fwrite_unlocked
+#else
+#define WRITE fwrite
+#endif
+
+Out out_new(FILE *f) { return (Out){.f = f, .line = IS_TERMINAL(f)}; }
+
+void out_destroy(Out *out) {
+    out_flush(out);
+    if (out->buf) {
+        mem_free(out->buf, OUT_BUF_SIZE);
+    }
+    *out = (Out){0};
+}
+
+void out_drain(Out *out) {
+    if (out->len) {
+        out->err |= WRITE(out->buf, sizeof(out->buf[0]), out->len, out->f) != out->len;
+        out->len = 0;
+    }
+}
+
+bool out_flush(Out *out) {
+    out_drain(out);
+    if (out->f) {
+        // ferror() also catches the writes of tag_printf()
+        out->err |= fflush(out->f) != 0 || ferror(out->f);
+    }
+    return !out->err;
+}
+
+void out_write(Out *out, const char *c, size_t len) {
+    if (!out->buf) {
+        out->buf = mem_allocate(OUT_BUF_SIZE);
+    }
+    bool newline = out->line && memchr(c, '\n', len);
+    if (out->len + len > OUT_BUF_SIZE) {
+        out_drain(out);
+        if (len > OUT_BUF_SIZE / 2) {
+            // too large to be worth copying
+            out->err |= WRITE(c, sizeof(c[0]), len, out->f) != len;
+            len = 0;
+        }
+    }
+    memcpy(out->buf + out->len, c, len);
+    out->len += len;
+    if (newline) {
+        out_flush(out);
+    }
+}
+
+void out_i64(Out *out, int64_t i) {
+    char buf[ITOA_MAX];
+    out_write(out, buf, itoa(i, buf));
+}
+
+void out_double(Out *out, double d) {
+    char buf[DTOA_MAX];
+    out_write(out, buf, dtoa(d, buf));
+}
+
+void out_tag(Out *out, Tag t) {
+    switch (tag_type(t)) {
+    case TYPE_STRING: {
+        const String *s = tag_to_string(t);
+        out_write(out, s->c, s->len);
+        break;
+    }
+    case TYPE_SLICE: {
+        const Slice *s = tag_to_slice(t);
+        out_write(out, s->c, s->len);
+        break;
+    }
+    case TYPE_SHORT_STR: {
+        char buf[SHORT_STR_MAX];
+        size_t len = short_str_chars(t, buf);
+        out_write(out, buf, len);
+        break;
+    }
+    case TYPE_I49P:
+    case TYPE_I49N:
+        out_i64(out, tag_to_i49(t));
+        break;
+    case TYPE_I64:
+        out_i64(out, *tag_to_i64(t));
+        break;
+    case TYPE_DOUBLE:
+        out_double(out, tag_to_double(t));
+        break;
+    default:
+        out_drain(out);
+        tag_printf(out->f, t);
+    }
+}
+
+extern inline void out_char(Out *, char);
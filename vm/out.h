@@ -0,0 +1,49 @@
+#ifndef slang_out_h
+#define slang_out_h
+
+#include "tag.h" // Tag
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define OUT_BUF_SIZE (64 * 1024)
+
+// Out collects the output of print in a buffer and hands it to its FILE in large blocks, instead
+// of going through stdio's formatting and locking for every value. Strings and numbers are copied
+// or formatted straight into the buffer, other values fall back to tag_printf(). Anything else
+// that writes to the same FILE must call out_drain() first to keep the output in order, and
+// out_flush() must run before exit or before writing to another stream, like on errors. When line
+// is set, every newline flushes, like stdio does for terminals. A failed write sets err, which
+// print checks after writing and out_flush() returns.
+typedef struct Out {
+    FILE *f;
+    char *buf; // allocated on the first write
+    size_t len;
+    bool line;
+    bool err; // a write to f failed
+} Out;
+
+Out out_new(FILE *); // line buffered if f is a terminal
+void out_destroy(Out *);
+void out_drain(Out *); // moves the buffer to the FILE
+bool out_flush(Out *); // drains and flushes the FILE, returns false if any write failed
+
+void out_write(Out *, const char *, size_t);
+void out_i64(Out *, int64_t);
+void out_double(Out *, double);
+void out_tag(Out *, Tag); // like tag_printf()
+
+inline void out_char(Out *out, char c) {
+    if (out->len == OUT_BUF_SIZE || !out->buf) {
+        out_write(out, &c, 1);
+        return;
+    }
+    out->buf[out->len++] = c;
+    if (c == '\n' && out->line) {
+        out_flush(out);
+    }
+}
+
+#endif
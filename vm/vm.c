@@ -2,25 +2,33 @@
 
 #include "builtins.h" // builtins
 #include "bytecode.h" // Chunk, chunk_*
+#include "file.h"     // file_map, file_line
 #include "fun.h"      // Fun, fun_*
 #include "list.h"     // List, list_*
 #include "mem.h"      // mem_allocate
+#include "out.h"      // out_*
+#include "range.h"    // Range, range_*
 #include "str.h"      // slice
 #include "table.h"    // Table, table_*
 #include "tag.h"      // Tag, tag_*, TAG_NIL
 
 #include <assert.h>
+#include <errno.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 static void destroy(VM *vm) {
     list_destroy(&vm->stack);
     list_destroy(&vm->temps);
+    list_destroy(&vm->lines);
     table_destroy(&vm->globals);
+    out_destroy(&vm->out);
     *vm = (VM){0};
 }
 
 static void runtime_err_header(VM *vm) {
+    out_flush(&vm->out); // the output so far goes before the error
     size_t line = chunk_lines_delta(vm->chunk, 0, vm->ip);
     fprintf(stderr, "[line %zu] runtime error: ", line + 1);
 }
@@ -52,18 +60,19 @@ void runtime_tag(VM *vm, Tag error) {
     putc('\n', stderr);
 }
 
-static inline bool list_key_to_idx(VM *vm, const List *l, Tag key, size_t *idx) {
+// checks a list or range index, len is the length of the list or range
+static inline bool key_to_idx(VM *vm, size_t len, Tag key, size_t *idx) {
     int64_t i;
     if (!as_int(key, &i)) {
-        runtime_err_tag(vm, "list index is non-integer: ", key);
+        runtime_err_tag(vm, "index is non-integer: ", key);
         return false;
     }
     if (i < 0) {
         runtime_err_tag(vm, "negative index: ", key);
         return false;
     }
-    if ((size_t)i >= list_len(l)) {
-        runtime_err_tag(vm, "list index out of bounds: ", key);
+    if ((size_t)i >= len) {
+        runtime_err_tag(vm, "index out of bounds: ", key);
         return false;
     }
     *idx = (size_t)i;
@@ -93,7 +102,21 @@ static inline void replace_top(VM *vm, Tag t) { *list_last(&vm->stack) = t; }
 static_assert(SIZE_MAX >= UINT64_MAX, "cannot cast uint64_t VM operands to size_t");
 #endif
 
-// obj and key don't pass ownership
+// Returns a value that can be pushed as a local. Values owned by the caller move to temps.
+static Tag local_ref(VM *vm, Tag t) {
+    if (tag_is_own(t)) {
+        list_append(&vm->temps, t);
+        return tag_to_ref(t);
+    }
+    return t;
+}
+
+// Reads a list item that the script can keep. list_load boxes a packed int out of the i49 range
+// from the i64 pool, and the box moves to temps. The list stays packed, so sum() and dot() keep
+// their fast paths.
+static Tag load_item(VM *vm, List *l, size_t idx) { return local_ref(vm, list_load(l, idx)); }
+
+// obj and key don't pass ownership, val is never owned
 bool item_get(VM *vm, Tag obj, Tag key, Tag *val) {
     if (tag_is_table(obj)) {
         Table *t = tag_to_table(obj);
@@ -104,10 +127,17 @@ bool item_get(VM *vm, Tag obj, Tag key, Tag *val) {
     } else if (tag_is_list(obj)) {
         List *l = tag_to_list(obj);
         size_t idx;
-        if (!list_key_to_idx(vm, l, key, &idx)) {
+        if (!key_to_idx(vm, list_len(l), key, &idx)) {
+            return false;
+        }
+        *val = load_item(vm, l, idx);
+    } else if (tag_is_range(obj)) {
+        Range *r = tag_to_range(obj);
+        size_t idx;
+        if (!key_to_idx(vm, range_len(r), key, &idx)) {
             return false;
         }
-        *val = *list_get(l, idx);
+        *val = i49_to_tag(range_get(r, idx));
     } else {
         runtime_err(vm, "cannot index type: ", tag_type_str(tag_type(obj)));
         return false;
@@ -115,28 +145,93 @@ bool item_get(VM *vm, Tag obj, Tag key, Tag *val) {
     return true;
 }
 
-// key passes ownership, val is input/output
-bool item_set(VM *vm, Tag obj, Tag key, Tag *val) {
+// Returns the value to store in a list. Owned values move to temps and val becomes a ref, unless
+// the list packs them. Then val stays owned by the caller.
+static Tag list_item(VM *vm, const List *l, Tag *val) {
+    if (!tag_is_own(*val)) {
+        *val = keep_line(vm, *val);
+        return *val;
+    }
+    if (!list_packs(l, *val)) {
+        list_append(&vm->temps, *val);
+        *val = tag_to_ref(*val);
+        return *val;
+    }
+    return tag_to_ref(*val);
+}
+
+// An item found by a single lookup, to be read and then replaced. Table values are replaced in
+// place, list items go through list_store because the list can be packed.
+typedef struct {
+    Tag *slot;
+    List *list;
+    size_t idx;
+} Item;
+
+// key doesn't pass ownership, the item is valid until the next write to obj
+static bool item_find(VM *vm, Tag obj, Tag key, Item *item) {
+    *item = (Item){0};
+    if (tag_is_table(obj)) {
+        item->slot = table_get_slot(tag_to_table(obj), key);
+        if (!item->slot) {
+            runtime_err_tag(vm, "key not found: ", key);
+            return false;
+        }
+    } else if (tag_is_list(obj)) {
+        item->list = tag_to_list(obj);
+        if (!key_to_idx(vm, list_len(item->list), key, &item->idx)) {
+            return false;
+        }
+    } else {
+        runtime_err(vm, "cannot index type: ", tag_type_str(tag_type(obj)));
+        return false;
+    }
+    return true;
+}
+
+static Tag item_load(const Item *item) {
+    return item->list ? list_load(item->list, item->idx) : *item->slot;
+}
+
+// val is input/output, like in item_set
+static void item_store(VM *vm, Item *item, Tag *val) {
+    if (item->list) {
+        list_store(item->list, item->idx, list_item(vm, item->list, val), &vm->temps);
+        return;
+    }
     if (tag_is_own(*val)) {
         list_append(&vm->temps, *val);
         *val = tag_to_ref(*val);
     }
+    *val = keep_line(vm, *val);
+    *item->slot = *val;
+}
+
+// key passes ownership, val is input/output
+bool item_set(VM *vm, Tag obj, Tag key, Tag *val) {
     if (tag_is_table(obj)) {
+        if (tag_is_own(*val)) {
+            list_append(&vm->temps, *val);
+            *val = tag_to_ref(*val);
+        }
+        *val = keep_line(vm, *val);
+        // only the constants and the builtin names are interned, the intern table never shrinks
         if (tag_is_own(key)) {
             list_append(&vm->temps, key);
             key = tag_to_ref(key);
         }
+        key = keep_line(vm, key);
         Table *t = tag_to_table(obj);
         table_set(t, key, *val);
     } else if (tag_is_list(obj)) {
         List *l = tag_to_list(obj);
         size_t idx;
-        bool idx_success = list_key_to_idx(vm, l, key, &idx);
+        bool idx_success = key_to_idx(vm, list_len(l), key, &idx);
         tag_free(key);
         if (!idx_success) {
             return false;
         }
-        *list_get(l, idx) = *val;
+        list_store(l, idx, list_item(vm, l, val), &vm->temps);
     } else {
         tag_free(key);
         runtime_err(vm, "non indexable type: ", tag_type_str(tag_type(obj)));
@@ -145,6 +240,184 @@ bool item_set(VM *vm, Tag obj, Tag key, Tag *val) {
     return true;
 }
 
+bool range_args(VM *vm, size_t args, Range *r) {
+    size_t first = list_len(&vm->stack) - args;
+    int64_t bounds[3] = {0, 0, 1};
+    for (size_t i = 0; i < args; i++) {
+        Tag t = *list_get(&vm->stack, first + i);
+        if (!tag_is_i49(t)) {
+            const char *err = tag_is_i64(t) ? "range argument too large: "
+                                            : "range expects ints; got: ";
+            runtime_err_tag(vm, err, t);
+            return false;
+        }
+        bounds[args == 1 ? 1 : i] = tag_to_i49(t);
+    }
+    if (bounds[2] == 0) {
+        runtime_err(vm, "range step cannot be zero", 0);
+        return false;
+    }
+    *r = (Range){.start = bounds[0], .stop = bounds[1], .step = bounds[2]};
+    if (range_len(r) > I49_MAX) {
+        runtime_err(vm, "range too long", 0);
+        return false;
+    }
+    return true;
+}
+
+bool file_arg(VM *vm, Tag path, Slice **file) {
+    char buf[SHORT_STR_MAX];
+    const char *c;
+    size_t len;
+    if (!as_str(path, buf, &c, &len)) {
+        runtime_err_tag(vm, "file path must be a string; got: ", path);
+        return false;
+    }
+    if (memchr(c, '\0', len)) {
+        runtime_err_tag(vm, "file path contains a null char: ", path);
+        return false;
+    }
+    char *c_path = mem_allocate(len + 1);
+    memcpy(c_path, c, len);
+    c_path[len] = '\0';
+    *file = file_map(c_path);
+    if (!*file) {
+        char err[256];
+        snprintf(err, sizeof(err), "cannot read file (%s): ", strerror(errno));
+        runtime_err_tag(vm, err, path);
+    }
+    mem_free(c_path, len + 1);
+    return *file != 0;
+}
+
+extern inline Tag keep_line(VM *, Tag);
+
+Tag line_copy(VM *vm, Tag t) {
+    if (tag_is_own(t)) {
+        return t;
+    }
+    for (size_t i = list_len(&vm->lines); i > 0; i--) {
+        size_t pos = tag_to_i49(*list_get(&vm->lines, i - 1));
+        if (pos >= list_len(&vm->stack)) {
+            continue; // the loop is gone, see forget_lines()
+        }
+        Tag line = *list_get(&vm->stack, pos);
+        if (tag_is_own(line) && tag_is_slice(line) && tag_to_slice(line) == tag_to_slice(t)) {
+            Slice *s = tag_to_slice(t);
+            Tag copy = slice_to_tag(slice_view(s, 0, s->len));
+            list_append(&vm->temps, copy);
+            return tag_to_ref(copy);
+        }
+    }
+    return t;
+}
+
+// forget_lines() drops the lines of the loops whose hidden locals start at pos or above. Loops
+// ended by break leave their positions behind, but they can only match owned lines.
+static void forget_lines(VM *vm, size_t pos) {
+    while (list_len(&vm->lines) && (size_t)tag_to_i49(*list_last(&vm->lines)) >= pos) {
+        list_pop(&vm->lines);
+    }
+}
+
+// iter_init() replaces the iterated list, table or range on top of the stack with a ref to it,
+// followed by two hidden locals: its length, cached to detect writes that would invalidate the
+// position, and the position of the next item
+static bool iter_init(VM *vm) {
+    Tag seq = top(vm);
+    size_t len;
+    if (tag_is_list(seq)) {
+        len = list_len(tag_to_list(seq));
+    } else if (tag_is_table(seq)) {
+        len = table_len(tag_to_table(seq));
+    } else if (tag_is_range(seq)) {
+        len = range_len(tag_to_range(seq));
+    } else {
+        runtime_err(vm, "cannot iterate over type: ", tag_type_str(tag_type(seq)));
+        return false;
+    }
+    assert(len <= I49_MAX && "iterated length out of i49 range");
+    replace_top(vm, local_ref(vm, seq));
+    push(vm, i49_to_tag(len));
+    push(vm, i49_to_tag(0));
+    return true;
+}
+
+// iter_next() pushes the next item of the iteration set up by iter_init() or LINES_INIT, or
+// jumps past the loop when there are none left
+static bool iter_next(VM *vm, size_t jump, bool kv) {
+    size_t stack_len = list_len(&vm->stack);
+    Tag seq = *list_get(&vm->stack, stack_len - 3);
+    size_t len = tag_to_i49(*list_get(&vm->stack, stack_len - 2));
+    Tag *pos_tag = list_get(&vm->stack, stack_len - 1);
+    size_t pos = tag_to_i49(*pos_tag);
+    Tag key, val;
+    if (tag_is_list(seq)) {
+        List *l = tag_to_list(seq);
+        if (list_len(l) != len) {
+            runtime_err(vm, "list changed size during iteration", 0);
+            return false;
+        }
+        if (pos == len) {
+            vm->ip += jump;
+            return true;
+        }
+        key = i49_to_tag(pos);
+        val = load_item(vm, l, pos);
+        pos++;
+    } else if (tag_is_range(seq)) {
+        // ranges can't change
+        if (pos == len) {
+            vm->ip += jump;
+            return true;
+        }
+        key = i49_to_tag(pos);
+        val = i49_to_tag(range_get(tag_to_range(seq), pos));
+        pos++;
+    } else if (tag_is_slice(seq)) {
+        // a file mapped by LINES_INIT, pos is the offset of the next line
+        Tag *line = list_get(&vm->stack, stack_len - 4);
+        if (pos == len) {
+            forget_lines(vm, stack_len - 4);
+            vm->ip += jump;
+            return true;
+        }
+        tag_free(*line); // the previous line, copied by keep_line() if it was stored
+        *line = file_line(tag_to_slice(seq), &pos);
+        key = TAG_NIL;
+        val = tag_is_ptr(*line) ? tag_to_ref(*line) : *line;
+    } else {
+        Table *t = tag_to_table(seq);
+        if (table_len(t) != len) {
+            runtime_err(vm, "table changed size during iteration", 0);
+            return false;
+        }
+        if (!table_next(t, &pos, &key, &val)) {
+            vm->ip += jump;
+            return true;
+        }
+        // the table keeps owning its keys and values
+        key = tag_is_ptr(key) ? tag_to_ref(key) : key;
+        val = tag_is_ptr(val) ? tag_to_ref(val) : val;
+    }
+    *pos_tag = i49_to_tag(pos);
+    if (kv) {
+        push(vm, key);
+        push(vm, val);
+    } else {
+        // a single variable gets the items of lists and ranges, and the keys of tables
+        push(vm, tag_is_table(seq) ? key : val);
+    }
+    return true;
+}
+
+// is_builtin() tells if a for-in loop still calls the builtin it was compiled for, globals
+// can be set to other values at any time
+static bool is_builtin(Tag t, bool (*builtin)(VM *, size_t)) {
+    return tag_is_fun(t) && tag_to_fun(t)->type == FUN_BUILTIN &&
+           tag_to_fun(t)->builtin.fun == builtin;
+}
+
 static bool run(VM *vm);
 
 bool call(VM *vm, size_t arity) {
@@ -190,10 +463,25 @@ bool call(VM *vm, size_t arity) {
     } else {
         res = f->builtin.fun(vm, arity);
     }
-    Tag result = top(vm);
+    Tag result = keep_line(vm, top(vm));
     CallFrame *frame = &vm->frames[--vm->current_frame];
     // NB: because we trunc the stack, we don't pop and free the values this
     // seems fine because locals don't own values, but maybe it isn't
+    // Loops over lines() are the exception, returning from them frees their file and line.
+    size_t result_pos = list_len(&vm->stack) - 1;
+    while (list_len(&vm->lines)) {
+        size_t pos = tag_to_i49(*list_last(&vm->lines));
+        if (pos < vm->frame_base) {
+            break;
+        }
+        list_pop(&vm->lines);
+        // the line and the file, a position left behind by break can point at a later loop's
+        for (size_t i = pos; i < pos + 2 && i < result_pos; i++) {
+            Tag *t = list_get(&vm->stack, i);
+            tag_free(*t);
+            *t = TAG_NIL;
+        }
+    }
     list_trunc(&vm->stack, vm->frame_base);
     replace_top(vm, result); // replace the function with the result
     vm->frame_base = frame->prev_frame_base;
@@ -242,6 +530,13 @@ static bool run(VM *vm) {
         case OP_GET_CONSTANT: {
             size_t idx = chunk_read_operator(vm->chunk, &vm->ip);
             Tag constant = chunk_get_const(vm->chunk, idx);
+            if (tag_is_table(constant)) {
+                // a frozen dict literal, each evaluation gets a table that copies it on write
+                Table *tab = mem_allocate(sizeof(*tab));
+                table_share(tab, tag_to_table(constant));
+                push(vm, table_to_tag(tab));
+                break;
+            }
             if (tag_is_ptr(constant)) {
                 constant = tag_to_ref(constant);
             }
@@ -315,6 +610,7 @@ static bool run(VM *vm) {
                 val = tag_to_ref(val);
                 replace_top(vm, val);
             }
+            val = keep_line(vm, val);
             // table_set returns true on new entries
             if (table_set(&vm->globals, var, val) != (opcode == OP_DEF_GLOBAL)) {
                 if (opcode == OP_DEF_GLOBAL) {
@@ -359,7 +655,7 @@ static bool run(VM *vm) {
                 // the top of the stack where its initial value is
             } else {
                 // local assignment
-                *list_get(&vm->stack, pos + vm->frame_base) = val;
+                *list_get(&vm->stack, pos + vm->frame_base) = keep_line(vm, val);
             }
             break;
         }
@@ -371,50 +667,57 @@ static bool run(VM *vm) {
             push(vm, val);
             break;
         }
-        case OP_DICT: {
+        case OP_DICT_N: {
+            size_t len = chunk_read_operator(vm->chunk, &vm->ip);
             Table *tab = mem_allocate(sizeof(*tab));
             *tab = (Table){0};
             Tag tag = table_to_tag(tab);
+            size_t first = list_len(&vm->stack) - 2 * len;
+            // literals keyed 0, 1, ... go into the array part and don't need an index
+            if (len && !tag_is_i49(*list_get(&vm->stack, first))) {
+                table_reserve(tab, len);
+            }
+            for (size_t i = first; i < first + 2 * len; i += 2) {
+                Tag key = *list_get(&vm->stack, i);
+                Tag val = *list_get(&vm->stack, i + 1);
+                // setting a key on a table can't fail
+                item_set(vm, tag, key, &val);
+            }
+            list_trunc(&vm->stack, first);
             push(vm, tag);
             break;
         }
-        case OP_LIST: {
+        case OP_LIST_N: {
+            size_t len = chunk_read_operator(vm->chunk, &vm->ip);
             List *list = mem_allocate(sizeof(*list));
-            *list = (List){0};
-            Tag tag = list_to_tag(list);
-            push(vm, tag);
-            break;
-        }
-        case OP_LIST_INIT: {
-            // leave the list on top of the stack
-            Tag val = pop(vm);
-            if (tag_is_own(val)) {
-                list_append(&vm->temps, val);
-                val = tag_to_ref(val);
+            *list = (List){.kind = LIST_NEW};
+            if (len) {
+                dynarray_resize(Tag)(&list->array, len);
+            }
+            size_t first = list_len(&vm->stack) - len;
+            for (size_t i = first; i < first + len; i++) {
+                Tag val = *list_get(&vm->stack, i);
+                list_push(list, list_item(vm, list, &val), &vm->temps);
+                tag_free(val); // still owned only if the list packed it
             }
-            // conversion should always succeed unless this is bad bytecode
-            List *l = tag_to_list(top(vm));
-            list_append(l, val);
+            list_trunc(&vm->stack, first);
+            push(vm, list_to_tag(list));
             break;
         }
         case OP_APPEND: {
             Tag val = pop(vm);
-            if (tag_is_own(val)) { // convert to ref before error check to avoid ref leak
-                list_append(&vm->temps, val);
-                val = tag_to_ref(val);
-            }
             Tag list = top(vm);
             if (!tag_is_list(list)) {
+                tag_free(val);
                 runtime_err(vm, "non-appendable type: ", tag_type_str(tag_type(list)));
                 return false;
             }
             List *l = tag_to_list(list);
-            list_append(l, val);
+            list_push(l, list_item(vm, l, &val), &vm->temps);
             tag_free(list); // [] []= 1;
             replace_top(vm, val);
             break;
         }
-        case OP_DICT_INIT:
         case OP_ITEM_SET: {
             Tag val = pop(vm);
             Tag key = pop(vm);
@@ -423,10 +726,8 @@ static bool run(VM *vm) {
                 tag_free(val);
                 return false;
             };
-            if (opcode == OP_ITEM_SET) {
-                tag_free(obj); // ({})[0] = 0;
-                replace_top(vm, val);
-            }
+            tag_free(obj); // ({})[0] = 0;
+            replace_top(vm, val);
             break;
         }
         case OP_ITEM_GET: {
@@ -449,12 +750,15 @@ static bool run(VM *vm) {
             Tag val = pop(vm);
             Tag key = pop(vm);
             Tag obj = top(vm);
-            Tag read_val;
-            if (!item_get(vm, obj, key, &read_val)) {
-                tag_free(key);
+            // a single lookup finds the value to read and replace
+            Item item;
+            bool item_find_success = item_find(vm, obj, key, &item);
+            tag_free(key);
+            if (!item_find_success) {
                 tag_free(val);
                 return false;
             }
+            Tag read_val = item_load(&item);
             Tag result = TAG_NIL;
             switch (opcode) {
             case OP_ITEM_SHORT_REMAINDER:
@@ -474,18 +778,112 @@ static bool run(VM *vm) {
             }
             if (tag_is_error(result)) {
                 runtime_tag(vm, result);
-                tag_free(key);
-                tag_free(result);
-                return false;
-            }
-            if (!item_set(vm, obj, key, &result)) {
                 tag_free(result);
                 return false;
             }
+            item_store(vm, &item, &result);
             tag_free(obj);
             replace_top(vm, result);
             break;
         }
+        case OP_ITER_INIT: {
+            if (!iter_init(vm)) {
+                return false;
+            }
+            break;
+        }
+        case OP_ITER_NEXT:
+        case OP_ITER_NEXT_KV: {
+            size_t jump = chunk_read_operator(vm->chunk, &vm->ip);
+            if (!iter_next(vm, jump, opcode == OP_ITER_NEXT_KV)) {
+                return false;
+            }
+            break;
+        }
+        case OP_LINES_INIT: {
+            // replaces lines and the path with four hidden locals: the current line and the
+            // mapped file, both owned by the loop, followed by the file's length and the offset of
+            // the next line
+            size_t stack_len = list_len(&vm->stack);
+            Tag fun = *list_get(&vm->stack, stack_len - 2);
+            if (!is_builtin(fun, builtin_lines)) {
+                // lines was set to something else, call it and iterate over its result after an
+                // unused first local
+                Tag path = top(vm);
+                *list_get(&vm->stack, stack_len - 2) = TAG_NIL;
+                replace_top(vm, fun);
+                push(vm, path);
+                if (!call(vm, 1) || !iter_init(vm)) {
+                    return false;
+                }
+                break;
+            }
+            Tag path = top(vm);
+            Slice *file;
+            if (!file_arg(vm, path, &file)) {
+                return false;
+            }
+            if (slice_len(file) > I49_MAX) {
+                slice_free(file);
+                runtime_err(vm, "file too large", 0);
+                return false;
+            }
+            tag_free(path);
+            forget_lines(vm, stack_len - 2);
+            list_append(&vm->lines, i49_to_tag(stack_len - 2));
+            *list_get(&vm->stack, stack_len - 2) = TAG_NIL;
+            replace_top(vm, slice_to_tag(file));
+            push(vm, i49_to_tag(slice_len(file)));
+            push(vm, i49_to_tag(0));
+            break;
+        }
+        case OP_FOR_RANGE_INIT: {
+            // replaces range and its arguments with the hidden locals: the next int, the end and
+            // the step
+            size_t args = chunk_read_operator(vm->chunk, &vm->ip);
+            Tag fun = *list_get(&vm->stack, list_len(&vm->stack) - args - 1);
+            if (!is_builtin(fun, builtin_range)) {
+                // range was set to something else, call it and iterate over its result, which
+                // FOR_RANGE tells apart because it doesn't start with an int
+                if (!call(vm, args) || !iter_init(vm)) {
+                    return false;
+                }
+                break;
+            }
+            Range r;
+            if (!range_args(vm, args, &r)) {
+                return false;
+            }
+            list_trunc(&vm->stack, list_len(&vm->stack) - args - 1);
+            push(vm, i49_to_tag(r.start));
+            push(vm, i49_to_tag(r.stop));
+            push(vm, i49_to_tag(r.step));
+            break;
+        }
+        case OP_FOR_RANGE: {
+            size_t jump = chunk_read_operator(vm->chunk, &vm->ip);
+            size_t stack_len = list_len(&vm->stack);
+            Tag *cur_tag = list_get(&vm->stack, stack_len - 3);
+            if (!tag_is_i49(*cur_tag)) {
+                // set up by ITER_INIT
+                if (!iter_next(vm, jump, false)) {
+                    return false;
+                }
+                break;
+            }
+            int64_t cur = tag_to_i49(*cur_tag);
+            int64_t end = tag_to_i49(*list_get(&vm->stack, stack_len - 2));
+            int64_t step = tag_to_i49(*list_get(&vm->stack, stack_len - 1));
+            if (step > 0 ? cur >= end : cur <= end) {
+                vm->ip += jump;
+                break;
+            }
+            // the next int stops at the end, which keeps it in the i49 range
+            bool last = step > 0 ? end - cur <= step : end - cur >= step;
+            *cur_tag = i49_to_tag(last ? end : cur + step);
+            push(vm, i49_to_tag(cur));
+            break;
+        }
         case OP_CALL: {
             size_t arity = chunk_read_operator(vm->chunk, &vm->ip);
             if (!call(vm, arity)) {
@@ -506,15 +904,19 @@ static bool run(VM *vm) {
 void register_globals(Table *globals) {
     for (size_t i = 0; i < builtins_n; i++) {
         Fun *fun = &builtins[i];
-        Tag name = slice_to_tag(&fun->builtin.name);
-        table_set(globals, tag_to_ref(name), tag_to_ref(fun_to_tag(fun)));
+        Tag name = tag_intern(tag_to_ref(slice_to_tag(&fun->builtin.name)));
+        table_set(globals, name, tag_to_ref(fun_to_tag(fun)));
     }
 }
 
 bool interpret(const Chunk *chunk) {
-    VM vm = (VM){.chunk = chunk};
+    VM vm = (VM){.chunk = chunk, .out = out_new(stdout)};
     register_globals(&vm.globals);
     bool result = run(&vm);
+    if (!out_flush(&vm.out) && result) {
+        fputs("runtime error: cannot write output\n", stderr);
+        result = false;
+    }
 #ifdef SLANG_DEBUG
     fputs("temps: ", stdout);
     list_print(&vm.temps);
@@ -2,7 +2,9 @@
 #define slang_vm_h
 
 #include "list.h"  // List
+#include "out.h"   // Out
 #include "table.h" // Table
+#include "tag.h"   // Tag, tag_is_slice
 
 #include <stddef.h> // size_t
 
@@ -10,6 +12,8 @@
 
 typedef struct Fun Fun;
 typedef struct Chunk Chunk;
+typedef struct Range Range;
+typedef struct Slice Slice;
 
 typedef struct {
     const Fun *f;
@@ -23,13 +27,25 @@ typedef struct VM {
     List stack;
     size_t frame_base;
     List temps;
+    List lines; // stack positions of the lines owned by for-in loops over lines(), see keep_line()
     Table globals;
     CallFrame frames[MAX_FRAMES];
     size_t current_frame;
+    Out out; // print's buffered stdout
 } VM;
 
 bool interpret(const Chunk *);
 bool call(VM *, size_t arity);
+bool range_args(VM *, size_t args, Range *); // checks the top args values on the stack
+bool file_arg(VM *, Tag path, Slice **);     // maps the file at path
+
+// For-in loops over lines() own the mapped file and the current line, and free the line when they
+// advance. keep_line() returns t, or a ref to a copy of t that moves to temps if t is one of these
+// lines. Values stored where they can outlive the loop's body go through it.
+Tag line_copy(VM *, Tag);
+inline Tag keep_line(VM *vm, Tag t) {
+    return list_len(&vm->lines) && tag_is_slice(t) ? line_copy(vm, t) : t;
+}
 
 void runtime_tag(VM *, Tag);
 void runtime_err_tag(VM *, const char *, Tag);